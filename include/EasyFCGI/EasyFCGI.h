@@ -6,7 +6,6 @@
 // #endif
 // #define GLZ_NULL_TERMINATED false
 
-#include <fcgiapp.h>
 #include <csignal>
 #include <cstddef>
 #include <memory>
@@ -28,6 +27,11 @@
 #include <stop_token>
 #include <flat_map>
 #include <cstdint>
+#include <bit>
+#include <charconv>
+#include <functional>
+#include <coroutine>
+#include <exception>
 #include "glaze/glaze.hpp"
 
 namespace glz
@@ -351,6 +355,42 @@ namespace ParseUtil
 
     [[nodiscard]] auto HexToChar( StrView HexString ) noexcept -> char;
     [[nodiscard]] auto DecodeURLFragment( StrView Fragment ) -> std::string;
+    auto DecodeURLFragment( StrView Fragment, std::string& Output ) -> void;  // append decoded to Output
+    auto DecodeURLFragment( StrView Fragment, char* Output ) -> char*;  // Output needs room for Fragment.length(), may be Fragment.data(), Return: end of decoded
+
+    constexpr auto HashKey( StrView Key ) noexcept -> std::uint64_t  // FNV-1a, usable for compile time tables
+    {
+        auto Hash = 0xcbf29ce484222325ull;
+        for( auto C : Key ) Hash = ( Hash ^ static_cast<unsigned char>( C ) ) * 0x100000001b3ull;
+        return Hash;
+    }
+
+    struct HashedKey  // key with its HashKey taken ahead of lookup
+    {
+        StrView Name;
+        std::uint64_t Hash;
+        constexpr explicit HashedKey( StrView Name ) noexcept : Name{ Name }, Hash{ HashKey( Name ) } {}
+    };
+
+    constexpr auto CGIHeaderChar( char C ) noexcept -> char  // "User-Agent" as in "HTTP_USER_AGENT"
+    {
+        if( C == '-' ) return '_';
+        if( 'a' <= C && C <= 'z' ) return static_cast<char>( C - 'a' + 'A' );
+        return C;
+    }
+
+    template<FixedString Header>
+    constexpr auto CGIHeaderName = [] {
+        auto Result = std::array<char, 5 + Header.size()>{ 'H', 'T', 'T', 'P', '_' };
+        RNG::transform( StrView{ Header }, Result.begin() + 5, CGIHeaderChar );
+        return Result;
+    }();
+
+    template<FixedString Header>
+    consteval auto operator""_Header() noexcept  // Request.Header["User-Agent"_Header], normalized and hashed at compile time
+    {
+        return HashedKey{ StrView{ CGIHeaderName<Header>.data(), CGIHeaderName<Header>.size() } };
+    }
 
 };  // namespace ParseUtil
 using ParseUtil::ConvertTo;
@@ -368,6 +408,7 @@ namespace HTTP
         Forbidden = 403,
         NotFound = 404,
         MethodNotAllowed = 405,
+        PayloadTooLarge = 413,
         UnsupportedMediaType = 415,
         UnprocessableEntity = 422,
         InternalServerError = 500,
@@ -561,30 +602,286 @@ namespace EasyFCGI
 
     namespace Config
     {
-        extern int DefaultBackLogNumber;  // evetually be capped by /proc/sys/net/core/somaxconncat,ie.4096
+        extern int DefaultBackLogNumber;  // --backlog N, default to /proc/sys/net/core/somaxconn, which also caps it
         extern bool RunAsDaemon;
         extern FS::path CWD;
         extern FS::path LogFilePath;
         extern FS::path PidFilePath;
-        extern FS::path SokcetPath;
+        extern FS::path SokcetPath;  // --socket PATH, or HOST:PORT / [IPV6]:PORT / :PORT to listen on TCP
+        extern std::size_t WorkerThreadCount;       // --threads N, default to hardware concurrency
+        extern std::vector<int> WorkerCPUAffinity;  // --affinity 0-3,8 , empty for no pinning
+        extern std::size_t WorkerProcessCount;      // --workers N, prefork N worker processes, 0 for single process
+        extern bool NUMAAware;                      // --numa, spread workers over NUMA nodes, memory preferred from local node
+        extern bool MultiplexConnections;           // --multiplex, accept concurrent requests on one upstream connection
+        extern bool UseIOUring;                     // --io-uring, io_uring transport for accept and receive, epoll as fallback
+        extern std::size_t MaxInFlightRequests;     // --max-inflight N, shed with 503 beyond N admitted requests, 0 for unlimited
+        extern std::chrono::milliseconds MaxQueueDelay;  // --max-queue-delay MS, shed with 503 if waited longer for a worker, 0 for unlimited
+        extern std::chrono::milliseconds RequestTimeout;  // --request-timeout MS, default deadline of every request, 0 for none
+        extern std::chrono::milliseconds ShutdownGracePeriod;  // --grace-period MS, drain in-flight requests on termination, default 10s
+        extern bool SocketHandover;  // --handover, take listen socket over from running instance, which then drains
+        extern bool ReusePort;                     // --reuseport, SO_REUSEPORT on TCP listener, processes bind the same port
+        extern std::chrono::seconds DeferAccept;   // --defer-accept S, TCP_DEFER_ACCEPT, accept once upstream sent data, default 1s
+        extern int ReceiveBufferSize;              // --rcvbuf BYTES, SO_RCVBUF of listener and its connections, 0 for system default
+        extern int SendBufferSize;                 // --sndbuf BYTES, SO_SNDBUF of listener and its connections, 0 for system default
+        extern std::size_t MaxBodySize;            // --max-body BYTES, 413 beyond, default 64 MiB, 0 for unlimited
+        extern std::size_t MaxFields;              // --max-fields N, 400 beyond N query / form pairs or multipart parts, default 1000, 0 for unlimited
+        extern std::size_t MaxJsonDepth;           // --max-json-depth N, 400 if Json body nests deeper, default 64, 0 for unlimited
+        extern FS::path UploadSpoolPath;           // --spool-uploads DIR, stream multipart file parts to unnamed files in DIR, empty to keep body in memory
+        extern std::size_t MaxFieldSize;           // --max-field BYTES, 413 beyond for a multipart field kept in memory while spooling, default 1 MiB, 0 for unlimited
+        // TCP connections accepted only from addresses in environment variable FCGI_WEB_SERVER_ADDRS ( comma separated ), if set
+        // listen sockets passed by systemd ( LISTEN_FDS / LISTEN_PID ) or by parent process ( --listen-fd N ) take precedence over SokcetPath
         auto LaunchOptionContains( StrView ) -> bool;                 // only target switch option format : -abc / --foo
         auto LaunchOptionValue( StrView ) -> std::optional<StrView>;  // only target option with arg : --foo=bar / --foo baz
     }  // namespace Config
 
+    // checked by the reactor before the request reaches a worker, rest of the body discarded
+    struct RequestLimits
+    {
+        std::size_t MaxBodySize = Config::MaxBodySize;
+        std::size_t MaxFields = Config::MaxFields;
+        std::size_t MaxJsonDepth = Config::MaxJsonDepth;
+        std::size_t MaxFieldSize = Config::MaxFieldSize;
+    };
+
+    // per route, longest matching prefix of DOCUMENT_URI ( SCRIPT_NAME if absent ) wins
+    // register before serving, e.g. LimitRoute( "/upload", { .MaxBodySize = 2uz << 30 } );
+    auto LimitRoute( StrView PathPrefix, RequestLimits ) -> void;
+
     auto DumpJson( const EasyFCGI::Json& ) -> std::string;
 
     // extern std::stop_source TerminationSource;
     extern std::stop_token TerminationToken;
     auto TerminationRequested() -> bool;
 
+    // requests received from upstream and not yet completed, in this process
+    // after TerminationToken activated, worker threads keep serving until this drops to 0 or grace period is over
+    auto InFlightRequests() -> std::size_t;
+
+    // shard of calling thread in Server::RunSharded, 0 otherwise
+    // index per shard state with it, no locking needed as long as handlers stay on their shard
+    auto CurrentShard() -> std::size_t;
+
+    struct ShardMetrics
+    {
+        std::uint64_t Requests{};
+        std::uint64_t Failures{};  // handler exceptions
+    };
+    auto ShardMetricsSnapshot() -> std::vector<ShardMetrics>;  // one per shard, empty if not sharded
+
     // Return:
     // [ true ]  if successfully slept for Duration;
     // [ false ] if TerminationToken activated
     auto SleepFor( Clock::duration Duration ) -> bool;
+    // same as above, also cut short by StopToken, e.g. Request.StopToken()
+    auto SleepFor( Clock::duration Duration, std::stop_token StopToken ) -> bool;
 
-    using SocketFileDescriptor = decltype( FCGX_OpenSocket( {}, {} ) );
+    using SocketFileDescriptor = int;
     // using ConnectionFileDescriptor = decltype( ::accept( {}, {}, {} ) );
 
+    // native FastCGI protocol engine, see https://fastcgi-archives.github.io/FastCGI_Specification.html
+    namespace FastCGI
+    {
+        constexpr auto ProtocolVersion = std::uint8_t{ 1 };
+        constexpr auto HeaderLength = 8uz;
+        constexpr auto MaxContentLength = 0xFFFFuz;
+        constexpr auto NullRequestId = std::uint16_t{ 0 };
+        constexpr auto KeepConnectionFlag = std::uint8_t{ 1 };
+
+        enum class RecordType : std::uint8_t {
+            BeginRequest = 1,
+            AbortRequest,
+            EndRequest,
+            Params,
+            StdIn,
+            StdOut,
+            StdErr,
+            Data,
+            GetValues,
+            GetValuesResult,
+            UnknownType,
+        };
+
+        enum class Role : std::uint16_t { Responder = 1, Authorizer, Filter };
+        enum class ProtocolStatus : std::uint8_t { RequestComplete, CantMultiplexConnection, Overloaded, UnknownRole };
+
+        struct RecordHeader
+        {
+            std::uint8_t Version;
+            RecordType Type;
+            std::uint16_t RequestId;
+            std::uint16_t ContentLength;
+            std::uint8_t PaddingLength;
+
+            static constexpr auto Decode( const char* Data ) -> RecordHeader
+            {
+                auto Byte = [Data]( std::size_t Index ) -> std::uint16_t { return static_cast<unsigned char>( Data[Index] ); };
+                return { .Version = static_cast<std::uint8_t>( Byte( 0 ) ),
+                         .Type = static_cast<RecordType>( Byte( 1 ) ),
+                         .RequestId = static_cast<std::uint16_t>( Byte( 2 ) << 8 | Byte( 3 ) ),
+                         .ContentLength = static_cast<std::uint16_t>( Byte( 4 ) << 8 | Byte( 5 ) ),
+                         .PaddingLength = static_cast<std::uint8_t>( Byte( 6 ) ) };
+            }
+
+            constexpr auto Encode( char* Data ) const -> void
+            {
+                Data[0] = static_cast<char>( Version );
+                Data[1] = static_cast<char>( Type );
+                Data[2] = static_cast<char>( RequestId >> 8 );
+                Data[3] = static_cast<char>( RequestId & 0xFF );
+                Data[4] = static_cast<char>( ContentLength >> 8 );
+                Data[5] = static_cast<char>( ContentLength & 0xFF );
+                Data[6] = static_cast<char>( PaddingLength );
+                Data[7] = '\0';
+            }
+
+            constexpr auto RecordLength() const -> std::size_t { return HeaderLength + ContentLength + PaddingLength; }
+        };
+
+        using ParamArray = char**;  // null terminated "NAME=VALUE" entries
+        auto GetParam( StrView, ParamArray ) -> const char*;
+
+        struct ParamSlot  // "NAME=VALUE\0" in RequestContext::ParamBuffer
+        {
+            static constexpr auto Empty = ~std::uint32_t{};
+            std::uint32_t HashTag{};  // upper half of name hash
+            std::uint32_t NameOffset{ Empty };
+            std::uint32_t NameLength{};
+            std::uint32_t ValueLength{};
+        };
+
+        struct Connection;  // opaque, owned by the reactor of the listen socket
+        struct Engine;      // opaque, reactor thread of the listen socket
+        struct UploadSpool;  // opaque, multipart body streamed to spool files as it arrives
+
+        // per request transport state, address stable for the whole request lifetime
+        struct RequestContext
+        {
+            SocketFileDescriptor ListenSocket{ -1 };
+            Engine* Owner{};  // reactor that assembled the request, also fires its deadline
+            std::shared_ptr<Connection> ConnectionPtr{};
+            std::uint16_t RequestId{};
+            bool KeepConnection{};
+            bool Finished{};
+            int Error{};  // errno of the first failed write
+            bool Admitted{};
+            std::chrono::steady_clock::time_point ReadyTime{};  // complete and queued for worker threads
+            std::chrono::steady_clock::time_point Deadline{ std::chrono::steady_clock::time_point::max() };
+            std::stop_source Cancellation{};  // deadline, FCGI_ABORT_REQUEST or upstream disconnect
+            std::string ParamBuffer{};
+            std::vector<char*> Environment{ nullptr };
+            std::vector<ParamSlot> ParamIndex{};  // open addressing by name hash, built along with Environment
+            std::string StdIn{};  // left empty if Spool is set
+            std::unique_ptr<UploadSpool> Spool{};
+            RequestLimits Limits{};  // of the route, set once params are complete
+            std::size_t BodyLength{};  // STDIN received so far
+            std::string OutBuffer{};  // framed STDOUT records pending write
+            std::size_t OpenRecordOffset{ std::string::npos };
+
+            // admission control, see Config::MaxInFlightRequests and Config::MaxQueueDelay
+            // Return: [ false ] if request should be shed
+            auto Admit() -> bool;
+            auto SetDeadline( std::chrono::steady_clock::time_point ) -> void;  // only tightens
+            auto ClearDeadline() -> void;
+            auto FindParam( ParseUtil::HashedKey ) const -> std::optional<StrView>;  // first param of name, value null terminated
+            auto Put( StrView ) -> int;
+            auto Flush() -> int;
+            auto Finish( std::uint32_t AppStatus = 0 ) -> void;  // end of STDOUT + END_REQUEST
+            ~RequestContext();
+        };
+    }  // namespace FastCGI
+
+    struct Request;
+
+    // coroutine request handlers, see Server::RunAsync
+    // a suspended handler costs its frame only, resumed by the worker pool
+    namespace Async
+    {
+        struct Task
+        {
+            struct promise_type
+            {
+                std::coroutine_handle<> Continuation{ std::noop_coroutine() };
+                std::exception_ptr Exception{};
+
+                auto get_return_object() -> Task { return Task{ std::coroutine_handle<promise_type>::from_promise( *this ) }; }
+                auto initial_suspend() noexcept -> std::suspend_always { return {}; }
+                auto final_suspend() noexcept
+                {
+                    struct ResumeContinuation
+                    {
+                        auto await_ready() noexcept -> bool { return false; }
+                        auto await_suspend( std::coroutine_handle<promise_type> Self ) noexcept { return Self.promise().Continuation; }
+                        auto await_resume() noexcept -> void {}
+                    };
+                    return ResumeContinuation{};
+                }
+                auto return_void() -> void {}
+                auto unhandled_exception() -> void { Exception = std::current_exception(); }
+            };
+
+            std::coroutine_handle<promise_type> Handle;
+
+            explicit Task( std::coroutine_handle<promise_type> Handle ) : Handle{ Handle } {}
+            Task( Task&& Other ) noexcept : Handle{ std::exchange( Other.Handle, {} ) } {}
+            Task( const Task& ) = delete;
+            ~Task()
+            {
+                if( Handle ) Handle.destroy();
+            }
+
+            // start the task, awaiting coroutine resumed on its completion
+            auto operator co_await() && noexcept
+            {
+                struct Awaiter
+                {
+                    std::coroutine_handle<promise_type> Handle;
+                    auto await_ready() noexcept -> bool { return ! Handle || Handle.done(); }
+                    auto await_suspend( std::coroutine_handle<> Caller ) noexcept
+                    {
+                        Handle.promise().Continuation = Caller;
+                        return Handle;
+                    }
+                    auto await_resume() -> void
+                    {
+                        if( Handle && Handle.promise().Exception ) std::rethrow_exception( Handle.promise().Exception );
+                    }
+                };
+                return Awaiter{ Handle };
+            }
+        };
+
+        // Return on resume:
+        // [ true ]  if successfully slept for Duration;
+        // [ false ] if TerminationToken activated
+        struct SleepAwaiter
+        {
+            Clock::duration Duration;
+            std::stop_token StopToken{};
+            std::optional<std::stop_callback<std::function<void()>>> ResumeOnStop{};
+
+            auto await_ready() const noexcept -> bool
+            {
+                return Duration <= Clock::duration::zero() || TerminationRequested() || StopToken.stop_requested();
+            }
+            auto await_suspend( std::coroutine_handle<> ) -> bool;
+            auto await_resume() const noexcept -> bool { return ! TerminationRequested() && ! StopToken.stop_requested(); }
+        };
+
+        // output queued on the connection, resumed once upstream has taken it
+        // Return on resume: same as Request::Flush
+        struct FlushAwaiter
+        {
+            const Request& Target;
+            mutable std::uint64_t Position{};  // end of this flush in the output stream of the connection
+            mutable int Result{};
+            auto await_ready() const -> bool;
+            auto await_suspend( std::coroutine_handle<> ) const -> void;
+            auto await_resume() const -> int;
+        };
+
+        auto SleepFor( Clock::duration, std::stop_token = {} ) -> SleepAwaiter;  // co_await Async::SleepFor( 1s, Request.StopToken() );
+    }  // namespace Async
+
     struct Response
     {
         HTTP::StatusCode StatusCode = HTTP::StatusCode::OK;
@@ -621,29 +918,207 @@ namespace EasyFCGI
         Response& Reset() &;
     };
 
+    // query string and urlencoded body decoded straight into members of a reflected struct, see Request::QueryAs
+    namespace FormBinding
+    {
+        template<typename T>
+        concept Bindable = glz::reflectable<T> || glz::glaze_object_t<T>;
+
+        template<typename T> constexpr bool IsVector = false;
+        template<typename T, typename A> constexpr bool IsVector<std::vector<T, A>> = true;
+        template<typename T> constexpr bool IsOptional = false;
+        template<typename T> constexpr bool IsOptional<std::optional<T>> = true;
+
+        // member indices in open addressing slots by key hash, laid out at compile time
+        template<Bindable T>
+        constexpr auto KeySlots = [] {
+            constexpr auto& Keys = glz::reflect<T>::keys;
+            auto Slots = std::array<std::size_t, std::bit_ceil( Keys.size() * 2 + 1 )>{};
+            Slots.fill( Keys.size() );
+            for( auto I = 0uz; I < Keys.size(); ++I )
+            {
+                auto Slot = ParseUtil::HashKey( Keys[I] ) & ( Slots.size() - 1 );
+                while( Slots[Slot] != Keys.size() ) Slot = ( Slot + 1 ) & ( Slots.size() - 1 );
+                Slots[Slot] = I;
+            }
+            return Slots;
+        }();
+
+        template<Bindable T>
+        constexpr auto FieldIndex( StrView Key ) noexcept -> std::size_t  // reflect<T>::size if no such member
+        {
+            constexpr auto& Keys = glz::reflect<T>::keys;
+            constexpr auto Mask = KeySlots<T>.size() - 1;
+            for( auto Slot = ParseUtil::HashKey( Key ) & Mask; KeySlots<T>[Slot] != Keys.size(); Slot = ( Slot + 1 ) & Mask )
+                if( Keys[KeySlots<T>[Slot]] == Key ) return KeySlots<T>[Slot];
+            return Keys.size();
+        }
+
+        template<std::size_t I, Bindable T>
+        constexpr auto FieldOf( T& Value ) -> decltype( auto )
+        {
+            if constexpr( glz::reflectable<T> )
+                return glz::get_member( Value, glz::get<I>( glz::to_tie( Value ) ) );
+            else
+                return glz::get_member( Value, glz::get<I>( glz::reflect<T>::values ) );
+        }
+
+        // Return: [ false ] if Encoded does not fit Target
+        template<typename Field>
+        auto Assign( Field& Target, StrView Encoded ) -> bool
+        {
+            if constexpr( std::same_as<Field, std::string> )
+            {
+                Target.clear();
+                ParseUtil::DecodeURLFragment( Encoded, Target );
+                return true;
+            }
+            else if constexpr( IsOptional<Field> ) { return Assign( Target.emplace(), Encoded ); }
+            else if constexpr( IsVector<Field> )  // one element per repeated key
+            {
+                auto Element = typename Field::value_type{};
+                if( ! Assign( Element, Encoded ) ) return false;
+                Target.push_back( std::move( Element ) );
+                return true;
+            }
+            else if constexpr( std::is_arithmetic_v<Field> )
+            {
+                char Buffer[64];
+                auto Value = Encoded;
+                if( Encoded.find_first_of( "%+" ) != StrView::npos )  // numbers seldom need decoding
+                {
+                    if( Encoded.length() > sizeof( Buffer ) ) return false;
+                    Value = { Buffer, ParseUtil::DecodeURLFragment( Encoded, Buffer ) };
+                }
+                if constexpr( std::same_as<Field, bool> )  // bare key sets flag
+                {
+                    if( Value.empty() || Value == "1" || Value == "true" || Value == "on" || Value == "yes" )
+                        Target = true;
+                    else if( Value == "0" || Value == "false" || Value == "off" || Value == "no" )
+                        Target = false;
+                    else
+                        return false;
+                    return true;
+                }
+                else  // no trimming, "+1" and " 1" rejected
+                {
+                    auto [End, Error] = std::from_chars( Value.data(), Value.data() + Value.length(), Target );
+                    return Error == std::errc{} && End == Value.data() + Value.length();
+                }
+            }
+            else static_assert( false, "QueryAs: member must be std::string, bool, arithmetic, or std::optional / std::vector of those" );
+        }
+
+        template<Bindable T>
+        auto AssignField( T& Value, std::size_t Index, StrView Encoded ) -> bool
+        {
+            using Setter = bool ( * )( T&, StrView );
+            constexpr auto Setters = []<std::size_t... I>( std::index_sequence<I...> ) {
+                return std::array<Setter, sizeof...( I )>{ +[]( T& Value, StrView Encoded ) { return Assign( FieldOf<I>( Value ), Encoded ); }... };
+            }( std::make_index_sequence<glz::reflect<T>::size>{} );
+            return Setters[Index]( Value, Encoded );
+        }
+
+        // "k1=v1&k2=v2" into members of Value, unknown keys skipped
+        // Return: first pair whose value does not fit its member
+        template<Bindable T>
+        auto BindEncoded( T& Value, StrView EncodedPairs ) -> std::optional<StrView>
+        {
+            constexpr auto MaxKeyLength = [] {
+                auto Max = 0uz;
+                for( auto Key : glz::reflect<T>::keys ) Max = std::max( Max, Key.length() );
+                return Max;
+            }();
+            char KeyBuffer[MaxKeyLength * 3 + 1];  // encoded keys any longer match no member
+            while( ! EncodedPairs.empty() )
+            {
+                auto Pair = EncodedPairs.substr( 0, EncodedPairs.find( '&' ) );
+                EncodedPairs.remove_prefix( std::min( Pair.length() + 1, EncodedPairs.length() ) );
+                auto Separator = Pair.find( '=' );
+                auto Key = Pair.substr( 0, Separator );
+                auto Encoded = Separator == StrView::npos ? StrView{} : Pair.substr( Separator + 1 );
+                if( Key.length() > MaxKeyLength * 3 ) continue;
+                if( Key.find_first_of( "%+" ) != StrView::npos ) Key = { KeyBuffer, ParseUtil::DecodeURLFragment( Key, KeyBuffer ) };
+                auto Index = FieldIndex<T>( Key );
+                if( Index < glz::reflect<T>::size && ! AssignField( Value, Index, Encoded ) ) return Pair;
+            }
+            return std::nullopt;
+        }
+    }  // namespace FormBinding
+
     struct Request
     {
+        // name-value pairs of query string and request body, decoded into a flat buffer on first access
+        // values returned refer into the buffer, valid until next request
         struct Query
         {
-            EasyFCGI::Json Json;
+            static constexpr auto NoEntry = ~std::uint32_t{};
+            struct Entry
+            {
+                std::uint32_t KeyOffset;
+                std::uint32_t KeyLength;
+                std::uint32_t ValueOffset;
+                std::uint32_t ValueLength;
+                std::uint32_t NextSameKey;  // NoEntry if last value of key
+                std::uint32_t LastSameKey;  // first entry of key only
+                std::uint32_t Count;        // first entry of key only
+            };
+
+            mutable std::string Buffer;
+            mutable std::vector<Entry> Entries;              // in order of appearance
+            mutable std::vector<std::uint32_t> Slots;        // open addressing by key hash, first entry of each key
+            mutable std::optional<EasyFCGI::Json> JsonView;  // built on first Json()
+            mutable FastCGI::RequestContext* Source{};       // not yet decoded from, if not null
+
+            auto Bind( FastCGI::RequestContext* ) -> void;
+            auto Materialize() const -> void;  // query string, then urlencoded / multipart / Json request body
+            auto clear() -> void;
+            auto Append( StrView Key, StrView Value ) -> void;
+            auto AppendEncoded( StrView EncodedPairs ) -> void;  // "k1=v1&k2=v2", URL decoded
+            auto AppendJson( EasyFCGI::Json&& ) -> void;          // top level members, non-string values dumped
+
+            auto Find( StrView ) const -> std::uint32_t;  // first entry of key, NoEntry if absent
+            auto KeyOf( const Entry& ) const -> StrView;
+            auto ValueOf( const Entry& ) const -> StrView;
+
             auto contains( StrView ) const -> bool;
-            auto CountRepeated( StrView ) const -> decltype( Json.size() );
-            static auto StringDump( const EasyFCGI::Json& ) -> std::string;
-            auto operator[]( StrView, std::size_t = 0 ) const -> std::string;
-            auto GetOptional( StrView, std::size_t = 0 ) const -> std::optional<std::string>;
+            auto CountRepeated( StrView ) const -> std::size_t;
+            auto operator[]( StrView, std::size_t = 0 ) const -> StrView;
+            auto GetOptional( StrView, std::size_t = 0 ) const -> std::optional<StrView>;
+            auto Json() const -> const EasyFCGI::Json&;  // { key : [ values ] }, or Json request body as is
         };
 
+        // name-value pairs of Cookie header, split once on first access
+        // values unquoted and percent decoded, refer into the param buffer or Decoded, valid until next request
         struct Cookie
         {
-            FCGX_ParamArray EnvPtr;
-            auto operator[]( StrView ) const -> StrView;
+            static constexpr auto NoEntry = ~std::uint32_t{};
+            using Entry = std::pair<StrView, StrView>;
+
+            mutable std::vector<Entry> Entries;          // in order of appearance, repeated names kept
+            mutable std::vector<std::uint32_t> Slots;    // open addressing by name hash, first entry of each name
+            mutable std::string Decoded;                 // values containing '%', reserved ahead so views stay valid
+            mutable FastCGI::RequestContext* Source{};  // not yet split, if not null
+
+            auto Bind( FastCGI::RequestContext* ) -> void;
+            auto Materialize() const -> void;
+
+            auto Find( StrView ) const -> std::uint32_t;  // first entry of name, NoEntry if absent
+            auto operator[]( StrView ) const -> StrView;  // first of name
+            auto contains( StrView ) const -> bool;
+            auto size() const -> std::size_t;
+            auto begin() const -> std::vector<Entry>::const_iterator;  // for( auto [Name, Value] : Request.Cookie )
+            auto end() const -> std::vector<Entry>::const_iterator;
         };
 
+        // looked up in the param index of the request, no allocation
         struct Header
         {
-            FCGX_ParamArray EnvPtr;
-            auto operator[]( StrView ) const -> StrView;
+            const FastCGI::RequestContext* Source{};
+            auto operator[]( StrView ) const -> StrView;  // "User-Agent", "user-agent" or "USER_AGENT" alike
+            auto operator[]( ParseUtil::HashedKey ) const -> StrView;  // "User-Agent"_Header
             auto contains( StrView ) const -> bool;
+            auto contains( ParseUtil::HashedKey ) const -> bool;
         };
 
         struct Files
@@ -656,28 +1131,33 @@ namespace EasyFCGI
                 StrView FileName{};
                 StrView ContentType{};
                 StrView ContentBody{};
+                int SpoolFD{ -1 };  // spooled upload, first SaveAs links the file instead of writing ContentBody
 
                 auto SaveAs( const FS::path&, const OverWriteOptions = Abort ) const -> std::optional<FS::path>;
             };
 
-            std::flat_map<StrView, std::vector<FileView>> Storage;
+            mutable std::flat_map<StrView, std::vector<FileView>> Storage;  // multipart body scanned on first access
+            mutable FastCGI::RequestContext* Source{};  // not yet scanned, if not null
+
+            auto Bind( FastCGI::RequestContext* ) -> void;
+            auto Materialize() const -> void;
             auto operator[]( StrView, std::size_t = 0 ) const -> FileView;
         };
 
         struct Response Response;
         struct Files Files;
-        std::string Payload;
+        StrView Payload;  // request body, held by FCGI_Request_Ptr
         struct Query Query;
         struct Header Header;
         struct Cookie Cookie;
-        std::unique_ptr<FCGX_Request> FCGX_Request_Ptr;
+        std::unique_ptr<FastCGI::RequestContext> FCGI_Request_Ptr;
         HTTP::RequestMethod Method;
         HTTP::ContentType ContentType;
 
         auto GetParam( StrView ParamName ) const -> StrView;  // Read FCGI envirnoment variables set up by upstream server
         auto AllHeaderEntries() const -> std::vector<StrView>;
         auto Accept() -> int;
-        auto Parse() -> int;
+        auto Parse() -> int;  // bind facets to current request, Query and Files decoded on first access, Json body validated up front
         explicit operator bool() const;
 
         Request() = default;
@@ -692,6 +1172,50 @@ namespace EasyFCGI
 
         auto operator[]( StrView, std::size_t = 0 ) const -> decltype( Query[{}, {}] );
 
+        enum class ErrorReport : unsigned char { Silent, Brief, Detailed };  // body of 400 response when binding fails
+
+        // Json request body read straight into T by glaze reflection, no EasyFCGI::Json tree built
+        // Return: [ std::nullopt ] on failure, response set to 400 unless header already sent
+        template<typename T, glz::opts Options = glz::opts{ .error_on_unknown_keys = false }>
+        auto BodyAs( ErrorReport Report = ErrorReport::Brief ) -> std::optional<T>
+        {
+            if( FCGI_Request_Ptr == nullptr ) return std::nullopt;
+            const auto& Body = FCGI_Request_Ptr->StdIn;  // null terminated
+            auto Result = std::optional<T>{ std::in_place };
+            auto Error = glz::read<Options>( *Result, Body );
+            if( ! Error ) return Result;
+            switch( Report )
+            {
+                case ErrorReport::Silent :   RespondBadRequest( {} ); break;
+                case ErrorReport::Brief :    RespondBadRequest( "Invalid Json." ); break;
+                case ErrorReport::Detailed : RespondBadRequest( glz::format_error( Error, Body ) ); break;
+            }
+            return std::nullopt;
+        }
+
+        // query string and urlencoded request body decoded straight into T by glaze reflection, no Query entries built
+        // repeated keys append to std::vector members, bare keys set bool members, unknown keys ignored
+        // Return: [ std::nullopt ] if a value does not fit its member, response set to 400 unless header already sent
+        template<FormBinding::Bindable T>
+        auto QueryAs( ErrorReport Report = ErrorReport::Brief ) -> std::optional<T>
+        {
+            if( FCGI_Request_Ptr == nullptr ) return std::nullopt;
+            auto Result = std::optional<T>{ std::in_place };
+            auto Failed = FormBinding::BindEncoded( *Result, GetParam( "QUERY_STRING" ) );
+            if( ! Failed && ContentType.Type == HTTP::ContentType::EnumValue::APPLICATION_X_WWW_FORM_URLENCODED )
+                Failed = FormBinding::BindEncoded( *Result, Payload );
+            if( ! Failed ) return Result;
+            switch( Report )
+            {
+                case ErrorReport::Silent :   RespondBadRequest( {} ); break;
+                case ErrorReport::Brief :    RespondBadRequest( "Invalid parameter." ); break;
+                case ErrorReport::Detailed : RespondBadRequest( std::format( "Invalid parameter: {}", *Failed ) ); break;
+            }
+            return std::nullopt;
+        }
+
+        auto RespondBadRequest( StrView Message ) -> void;  // no-op once header sent
+
         auto Send( StrView ) const -> void;
         auto SendLine( StrView = {} ) const -> void;
 
@@ -704,27 +1228,51 @@ namespace EasyFCGI
         // auto SendLine( const std::format_string<Args...>&, Args&&... ) const;
 
         auto FlushHeader() -> HTTP::StatusCode;
-        auto FlushResponse() -> decltype( FCGX_FFlush( {} ) );
+        auto FlushResponse() -> int;
+        auto Flush() const -> int;  // write out buffered output, fails once StopToken fired
+        auto FlushAsync() const -> Async::FlushAwaiter;  // co_await, slow upstream parks the handler instead of the thread
         auto EarlyFinish() -> void;
         auto SSE_Start() -> void;
-        auto SSE_Error() const -> decltype( FCGX_GetError( {} ) );
+        auto SSE_Error() const -> int;
         auto SSE_Send( std::convertible_to<StrView> auto&&... Content ) const
         {
             ( Send( Content ), ... );
             SendLine();
             SendLine();
-            return FCGX_FFlush( FCGX_Request_Ptr->out );
+            return Flush();
+        };
+        auto SSE_SendAsync( std::convertible_to<StrView> auto&&... Content ) const
+        {
+            ( Send( Content ), ... );
+            SendLine();
+            SendLine();
+            return FlushAsync();
         };
 
+        // fires on deadline, FCGI_ABORT_REQUEST or upstream disconnect
+        // deadline set by Config::RequestTimeout, tightened by upstream header X-Request-Timeout (ms) or SetDeadline
+        auto StopToken() const -> std::stop_token;
+        auto SetDeadline( Clock::duration ) -> void;  // since arrival, only tightens, e.g. per route
+
         auto Dump() const -> std::string;
 
         // virtual
         ~Request();
     };
 
+    using RequestHandler = std::function<void( Request& )>;
+    using AsyncRequestHandler = std::function<Async::Task( Request& )>;
+
     // auto UnixSocketName( SocketFileDescriptor FD ) -> FS::path;
     struct Server
     {
+        struct WorkerPoolOptions
+        {
+            std::size_t ThreadCount = Config::WorkerThreadCount;
+            std::vector<int> CPUAffinity = Config::WorkerCPUAffinity;  // worker N pinned to CPUAffinity[ N % size ]
+            bool NUMAAware = Config::NUMAAware;  // without CPUAffinity, worker N pinned to CPUs of node N % node count
+        };
+
         struct RequestQueue
         {
             SocketFileDescriptor ListenSocket;
@@ -759,6 +1307,35 @@ namespace EasyFCGI
             auto end() const -> Sentinel;
         } RequestQueue;
 
+        // worker threads take turns on requests assembled by the reactor of ListenSocket
+        // blocks until TerminationToken activated and all workers finished
+        auto Run( RequestHandler ) -> void;
+        auto Run( RequestHandler, WorkerPoolOptions ) -> void;
+
+        // coroutine handlers started and resumed by worker threads, any number may be suspended at once
+        // blocks until TerminationToken activated and all handlers completed
+        auto RunAsync( AsyncRequestHandler ) -> void;
+        auto RunAsync( AsyncRequestHandler, WorkerPoolOptions ) -> void;
+
+        struct ShardOptions
+        {
+            std::size_t ShardCount = Config::WorkerThreadCount;
+            std::vector<int> CPUAffinity = Config::WorkerCPUAffinity;  // shard N pinned to CPUAffinity[ N % size ], default to allowed CPUs
+            bool NUMAAware = Config::NUMAAware;  // default CPUs interleaved across nodes, memory preferred from local node
+        };
+
+        // thread per core, each shard owns a listen socket, reactor and worker pinned to one CPU
+        // TCP : shards share the port through SO_REUSEPORT, requires --reuseport
+        // unix socket : shard N > 0 listens on "<socket>.N", list them all in nginx upstream
+        // blocks until TerminationToken activated and all shards finished
+        auto RunSharded( RequestHandler ) -> void;
+        auto RunSharded( RequestHandler, ShardOptions ) -> void;
+
+        // coroutine handler passed to Run would be dropped without being started, use RunAsync
+        template<typename Handler, typename... Options>
+        requires std::same_as<std::invoke_result_t<Handler&, Request&>, Async::Task>
+        auto Run( Handler&&, Options&&... ) -> void = delete;
+
         Server( SocketFileDescriptor );
         Server();
         Server( const FS::path& );
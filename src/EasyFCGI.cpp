@@ -1,11 +1,35 @@
 #include "EasyFCGI/EasyFCGI.h"
-#include <fcgiapp.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
 #include <cstddef>
 #include <cstdio>
+#include <cstring>
 #include <array>
+#include <bit>
+#include <deque>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <unordered_map>
 #include <print>
+#if defined( __SSE2__ )
+#include <immintrin.h>
+#endif
 
 //explicit template instantiation
 template struct std::formatter<HTTP::RequestMethod>;
@@ -44,123 +68,2279 @@ namespace ParseUtil
         return std::bit_cast<char>( HexString | ConvertTo<unsigned char, 16> | FallBack( '?' ) );
     }
 
+    static constexpr auto HexDigitValue = [] {
+        auto Table = std::array<signed char, 256>{};
+        Table.fill( -1 );
+        for( auto C : VIEW::iota( '0', ':' ) ) Table[C] = static_cast<signed char>( C - '0' );
+        for( auto C : VIEW::iota( 'A', 'G' ) ) Table[C] = static_cast<signed char>( C - 'A' + 10 );
+        for( auto C : VIEW::iota( 'a', 'g' ) ) Table[C] = static_cast<signed char>( C - 'a' + 10 );
+        return Table;
+    }();
+
+    // copy up to next '%' or '+', whole blocks stored at once
+    // a block is stored only if plain throughout, so Out may trail In over the same buffer
+    static auto CopyPlainSpan( const char*& In, const char* End, char*& Out ) -> void
+    {
+        auto Advance = [&]( std::size_t Length ) {
+            In += Length;
+            Out += Length;
+        };
+#if defined( __AVX2__ )
+        for( auto Percent = _mm256_set1_epi8( '%' ), Plus = _mm256_set1_epi8( '+' ); End - In >= 32; )
+        {
+            auto Block = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( In ) );
+            auto Special = _mm256_or_si256( _mm256_cmpeq_epi8( Block, Percent ), _mm256_cmpeq_epi8( Block, Plus ) );
+            auto Mask = static_cast<std::uint32_t>( _mm256_movemask_epi8( Special ) );
+            if( Mask != 0 )
+            {
+                std::memmove( Out, In, std::countr_zero( Mask ) );  // plain prefix only, rest of block not yet decoded
+                return Advance( std::countr_zero( Mask ) );
+            }
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( Out ), Block );
+            Advance( 32 );
+        }
+#endif
+#if defined( __SSE2__ )
+        for( auto Percent = _mm_set1_epi8( '%' ), Plus = _mm_set1_epi8( '+' ); End - In >= 16; )
+        {
+            auto Block = _mm_loadu_si128( reinterpret_cast<const __m128i*>( In ) );
+            auto Special = _mm_or_si128( _mm_cmpeq_epi8( Block, Percent ), _mm_cmpeq_epi8( Block, Plus ) );
+            auto Mask = static_cast<std::uint32_t>( _mm_movemask_epi8( Special ) );
+            if( Mask != 0 )
+            {
+                std::memmove( Out, In, std::countr_zero( Mask ) );  // plain prefix only, rest of block not yet decoded
+                return Advance( std::countr_zero( Mask ) );
+            }
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( Out ), Block );
+            Advance( 16 );
+        }
+#endif
+        while( In < End && *In != '%' && *In != '+' ) *Out++ = *In++;
+    }
+
+    // '+' as space, "%XY" as byte, malformed escape as '?'
+    auto DecodeURLFragment( StrView Fragment, char* Output ) -> char*
+    {
+        auto In = Fragment.data();
+        auto End = In + Fragment.length();
+        while( true )
+        {
+            CopyPlainSpan( In, End, Output );
+            if( In == End ) return Output;
+            if( *In == '+' )
+            {
+                *Output++ = ' ';
+                ++In;
+                continue;
+            }
+            auto High = End - In > 1 ? HexDigitValue[static_cast<unsigned char>( In[1] )] : -1;
+            auto Low = End - In > 2 ? HexDigitValue[static_cast<unsigned char>( In[2] )] : -1;
+            *Output++ = High < 0 || Low < 0 ? '?' : static_cast<char>( High << 4 | Low );
+            In += std::min( 3z, End - In );
+        }
+    }
+
+    auto DecodeURLFragment( StrView Fragment, std::string& Output ) -> void
+    {
+        auto Offset = Output.length();
+        Output.resize_and_overwrite( Offset + Fragment.length(), [&]( char* Data, std::size_t ) {  //
+            return static_cast<std::size_t>( DecodeURLFragment( Fragment, Data + Offset ) - Data );
+        } );
+    }
+
     [[nodiscard]]
     auto DecodeURLFragment( StrView Fragment ) -> std::string
     {
-        constexpr auto EncodeDigitWidth = 2uz;
-        auto Result = std::string{};
-        auto [FirstPart, OtherParts] = Fragment | SplitBy( '%' ) | SplitAt( 1 );
-        for( auto LeadingText : FirstPart ) Result += LeadingText | RestoreSpaceChar;
-        for( auto Segment : OtherParts )
+        auto Result = std::string{};
+        Result.reserve( Fragment.length() );
+        DecodeURLFragment( Fragment, Result );
+        return Result;
+    }
+}  // namespace ParseUtil
+
+namespace EasyFCGI
+{
+    using ParseUtil::operator""_FMT;
+
+    namespace Config
+    {
+        int DefaultBackLogNumber = LaunchOptionValue( "backlog" ).and_then( ConvertTo<int> ).value_or( [] {
+            auto SoMaxConn = ReadContent( "/proc/sys/net/core/somaxconn" );
+            if( SoMaxConn.empty() ) return 4096;
+            return StrView{ SoMaxConn.data(), SoMaxConn.size() } | ConvertTo<int> | ParseUtil::FallBack( 4096 );
+        }() );
+
+        auto CommandLine()
+        {
+            static auto CommandLineBuffer = ReadContent( "/proc/self/cmdline" );
+            static auto CommandLine = CommandLineBuffer                         //
+                                      | VIEW::take( CommandLineBuffer.size() )  // keep trailing '\0'
+                                      | VIEW::split( '\0' )                     // will result in ending empty element
+                                      | VIEW::transform( RNG::data )            // reduce back to char*
+                                      | RNG::to<std::vector>();
+            CommandLine.back() = &CommandLineBuffer.back();  // end argv with "\0"
+            return CommandLine;
+        }
+
+        bool RunAsDaemon = LaunchOptionContains( "d" );
+        auto ScriptName = FS::path( CommandLine()[0] ).filename().replace_extension( {} ).string();
+
+        FS::path CWD{};
+        FS::path LogFilePath{};
+        FS::path PidFilePath{};
+        FS::path SokcetPath{};
+
+        static auto ParseCPUList( StrView CPUList ) -> std::vector<int>
+        {
+            using namespace ParseUtil;
+            auto Result = std::vector<int>{};
+            for( auto CPURange : CPUList | SplitBy( ',' ) )
+            {
+                auto [First, Last] = CPURange | SplitOnceBy( '-' );
+                auto FirstCPU = First | ConvertTo<int> | FallBack( -1 );
+                auto LastCPU = Last.empty() ? FirstCPU : Last | ConvertTo<int> | FallBack( -1 );
+                if( FirstCPU < 0 || LastCPU < FirstCPU ) continue;
+                for( auto CPU : VIEW::iota( FirstCPU, LastCPU + 1 ) ) Result.push_back( CPU );
+            }
+            return Result;
+        }
+
+        std::size_t WorkerThreadCount = [] {
+            auto ThreadCount = LaunchOptionValue( "threads" ).and_then( ConvertTo<int> ).value_or( 0 );
+            if( ThreadCount > 0 ) return static_cast<std::size_t>( ThreadCount );
+            return std::max( 1uz, static_cast<std::size_t>( std::thread::hardware_concurrency() ) );
+        }();
+        std::vector<int> WorkerCPUAffinity = LaunchOptionValue( "affinity" ).transform( ParseCPUList ).value_or( std::vector<int>{} );
+        std::size_t WorkerProcessCount = static_cast<std::size_t>( std::max( 0, LaunchOptionValue( "workers" ).and_then( ConvertTo<int> ).value_or( 0 ) ) );
+        bool NUMAAware = LaunchOptionContains( "numa" );
+        bool MultiplexConnections = LaunchOptionContains( "multiplex" );
+        bool UseIOUring = LaunchOptionContains( "io-uring" );
+        std::size_t MaxInFlightRequests = static_cast<std::size_t>( std::max( 0, LaunchOptionValue( "max-inflight" ).and_then( ConvertTo<int> ).value_or( 0 ) ) );
+        std::chrono::milliseconds MaxQueueDelay{ std::max( 0, LaunchOptionValue( "max-queue-delay" ).and_then( ConvertTo<int> ).value_or( 0 ) ) };
+        std::chrono::milliseconds RequestTimeout{ std::max( 0, LaunchOptionValue( "request-timeout" ).and_then( ConvertTo<int> ).value_or( 0 ) ) };
+        std::chrono::milliseconds ShutdownGracePeriod{ std::max( 0, LaunchOptionValue( "grace-period" ).and_then( ConvertTo<int> ).value_or( 10'000 ) ) };
+        bool SocketHandover = LaunchOptionContains( "handover" );
+        bool ReusePort = LaunchOptionContains( "reuseport" );
+        std::chrono::seconds DeferAccept{ std::max( 0, LaunchOptionValue( "defer-accept" ).and_then( ConvertTo<int> ).value_or( 1 ) ) };
+        int ReceiveBufferSize = std::max( 0, LaunchOptionValue( "rcvbuf" ).and_then( ConvertTo<int> ).value_or( 0 ) );
+        int SendBufferSize = std::max( 0, LaunchOptionValue( "sndbuf" ).and_then( ConvertTo<int> ).value_or( 0 ) );
+        std::size_t MaxBodySize = LaunchOptionValue( "max-body" ).and_then( ConvertTo<std::size_t> ).value_or( 64uz << 20 );
+        std::size_t MaxFields = LaunchOptionValue( "max-fields" ).and_then( ConvertTo<std::size_t> ).value_or( 1000 );
+        std::size_t MaxJsonDepth = LaunchOptionValue( "max-json-depth" ).and_then( ConvertTo<std::size_t> ).value_or( 64 );
+        FS::path UploadSpoolPath = LaunchOptionValue( "spool-uploads" ).transform( []( StrView Path ) { return FS::path( Path ); } ).value_or( FS::path{} );
+        std::size_t MaxFieldSize = LaunchOptionValue( "max-field" ).and_then( ConvertTo<std::size_t> ).value_or( 1uz << 20 );
+
+        auto LaunchOptionContains( StrView TargetOption ) -> bool
+        {
+            for( StrView Option : CommandLine() )
+            {
+                if( Option.starts_with( "--" ) )
+                {
+                    Option.remove_prefix( 2 );
+                    if( Option == TargetOption ) return true;
+                }
+                else if( Option.starts_with( '-' ) )
+                {
+                    Option.remove_prefix( 1 );
+                    if( Option.contains( TargetOption ) ) return true;
+                }
+            }
+            return false;
+        }
+
+        auto LaunchOptionValue( StrView TargetOption ) -> std::optional<StrView>
+        {
+            for( auto&& [OptionKey, OptionValue] : CommandLine() | VIEW::pairwise )
+            {
+                auto Option = StrView( OptionKey );
+                if( Option.starts_with( "--" ) )
+                    Option.remove_prefix( 2 );
+                else if( Option.starts_with( '-' ) )
+                    Option.remove_prefix( 1 );
+                else
+                    continue;
+                if( ! Option.starts_with( TargetOption ) ) continue;
+
+                Option.remove_prefix( TargetOption.length() );
+                if( Option.empty() )
+                {
+                    if( OptionValue[0] == '-' ) return std::nullopt;
+                    return OptionValue;
+                }
+                else if( Option[0] == '=' )
+                {
+                    Option.remove_prefix( 1 );
+                    if( Option.empty() ) return std::nullopt;
+                    return Option;
+                }
+            }
+            return std::nullopt;
+        }
+
+    }  // namespace Config
+
+    auto DumpJson( const EasyFCGI::Json& J ) -> std::string
+    {
+        if( auto TryDump = J.dump() )
+        {
+            return std::move( TryDump.value() );
+        }
+        else
+        {
+            return std::format( R"({{"DumpError":"{}"}})", TryDump.error().custom_error_message );
+        }
+    }
+
+    static auto RouteLimitTable = std::vector<std::pair<std::string, RequestLimits>>{};  // longest prefix first
+
+    auto LimitRoute( StrView PathPrefix, RequestLimits Limits ) -> void
+    {
+        auto Position = RNG::find_if( RouteLimitTable, [&]( auto& Entry ) { return Entry.first.length() <= PathPrefix.length(); } );
+        RouteLimitTable.emplace( Position, PathPrefix, Limits );
+    }
+
+    static auto LimitsOf( StrView Path ) -> RequestLimits
+    {
+        for( auto& [PathPrefix, Limits] : RouteLimitTable )
+            if( Path.starts_with( PathPrefix ) ) return Limits;
+        return {};
+    }
+
+    auto TerminationSource = std::stop_source{};
+    std::stop_token TerminationToken = TerminationSource.get_token();
+    auto TerminationRequested() -> bool { return TerminationToken.stop_requested(); }
+
+    auto SleepFor( Clock::duration SleepDuartion ) -> bool
+    {
+        auto CVA = std::condition_variable_any{};
+        auto DummyMutex = std::mutex{};
+        auto DummyLock = std::unique_lock{ DummyMutex };
+        CVA.wait_for( DummyLock, TerminationToken, SleepDuartion, TerminationRequested );
+        return ! TerminationRequested();
+    }
+
+    auto SleepFor( Clock::duration SleepDuartion, std::stop_token StopToken ) -> bool
+    {
+        auto Combined = std::stop_source{};
+        auto StopOnTermination = std::stop_callback{ TerminationToken, [&Combined] { Combined.request_stop(); } };
+        auto StopOnRequest = std::stop_callback{ StopToken, [&Combined] { Combined.request_stop(); } };
+        auto CVA = std::condition_variable_any{};
+        auto DummyMutex = std::mutex{};
+        auto DummyLock = std::unique_lock{ DummyMutex };
+        CVA.wait_for( DummyLock, Combined.get_token(), SleepDuartion, [] { return false; } );
+        return ! Combined.stop_requested();
+    }
+
+    // multipart/form-data, RFC 7578 / RFC 2046
+    namespace MultiPart
+    {
+        // by RFC 2046, boundary is at most 70 character long
+        constexpr auto BoundaryLengthLimit = 70uz;
+
+        // boundary parameter of Content-Type, quoted or not
+        static auto BoundaryOf( StrView ContentTypeField ) -> StrView
+        {
+            using namespace ParseUtil;
+            auto Value = ContentTypeField | After( "boundary=" );
+            if( Value.starts_with( '"' ) ) return Value | Between( '"' );
+            return Value.substr( 0, Value.find( ';' ) ) | TrimSpace;
+        }
+
+        // "\r\n--boundary", SIMD prefilter on first and last byte, Horspool for the rest
+        struct DelimiterSearcher
+        {
+            std::array<char, BoundaryLengthLimit + 4> Storage{};
+            StrView Delimiter{};
+            std::array<std::uint8_t, 256> Skip{};
+
+            DelimiterSearcher( const DelimiterSearcher& ) = delete;  // Delimiter views Storage
+            explicit DelimiterSearcher( StrView Boundary )
+            {
+                auto End = RNG::copy( Boundary, RNG::copy( "\r\n--"sv, Storage.data() ).out ).out;
+                Delimiter = { Storage.data(), End };
+                Skip.fill( static_cast<std::uint8_t>( Delimiter.length() ) );
+                for( auto Index : VIEW::iota( 0uz, Delimiter.length() - 1 ) )  //
+                    Skip[static_cast<unsigned char>( Delimiter[Index] )] = static_cast<std::uint8_t>( Delimiter.length() - 1 - Index );
+            }
+
+            auto MatchAt( const char* Candidate ) const -> bool { return std::memcmp( Candidate + 1, Delimiter.data() + 1, Delimiter.length() - 2 ) == 0; }
+
+            // Return: offset of next delimiter at or after From, npos if none
+            auto Find( StrView Haystack, std::size_t From ) const -> std::size_t
+            {
+                auto Length = Delimiter.length();
+                auto Data = Haystack.data();
+                auto Size = Haystack.length();
+#if defined( __AVX2__ )
+                for( auto First = _mm256_set1_epi8( Delimiter.front() ), Last = _mm256_set1_epi8( Delimiter.back() ); From + Length - 1 + 32 <= Size; From += 32 )
+                {
+                    auto Head = _mm256_cmpeq_epi8( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( Data + From ) ), First );
+                    auto Tail = _mm256_cmpeq_epi8( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( Data + From + Length - 1 ) ), Last );
+                    for( auto Mask = static_cast<std::uint32_t>( _mm256_movemask_epi8( _mm256_and_si256( Head, Tail ) ) ); Mask != 0; Mask &= Mask - 1 )
+                        if( MatchAt( Data + From + std::countr_zero( Mask ) ) ) return From + std::countr_zero( Mask );
+                }
+#endif
+#if defined( __SSE2__ )
+                for( auto First = _mm_set1_epi8( Delimiter.front() ), Last = _mm_set1_epi8( Delimiter.back() ); From + Length - 1 + 16 <= Size; From += 16 )
+                {
+                    auto Head = _mm_cmpeq_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( Data + From ) ), First );
+                    auto Tail = _mm_cmpeq_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( Data + From + Length - 1 ) ), Last );
+                    for( auto Mask = static_cast<std::uint32_t>( _mm_movemask_epi8( _mm_and_si128( Head, Tail ) ) ); Mask != 0; Mask &= Mask - 1 )
+                        if( MatchAt( Data + From + std::countr_zero( Mask ) ) ) return From + std::countr_zero( Mask );
+                }
+#endif
+                for( ; From + Length <= Size; From += Skip[static_cast<unsigned char>( Data[From + Length - 1] )] )
+                    if( Data[From + Length - 1] == Delimiter.back() && Data[From] == Delimiter.front() && MatchAt( Data + From ) ) return From;
+                return StrView::npos;
+            }
+        };
+
+        struct PartHeader
+        {
+            StrView Name{};
+            StrView FileName{};
+            StrView ContentType{};
+        };
+
+        static auto EqualIgnoreCase( StrView LHS, StrView RHS ) -> bool
+        {
+            return RNG::equal( LHS, RHS, []( char L, char R ) { return std::tolower( static_cast<unsigned char>( L ) ) == std::tolower( static_cast<unsigned char>( R ) ); } );
+        }
+
+        // header block of one part, lines separated by CRLF, single pass
+        static auto ParseHeader( StrView Block ) -> PartHeader
+        {
+            using namespace ParseUtil;
+            auto Result = PartHeader{};
+            while( ! Block.empty() )
+            {
+                auto LineEnd = std::min( Block.find( "\r\n" ), Block.length() );
+                auto Line = Block.substr( 0, LineEnd );
+                Block.remove_prefix( std::min( LineEnd + 2, Block.length() ) );
+
+                auto Colon = Line.find( ':' );
+                if( Colon == StrView::npos ) continue;
+                auto FieldName = Line.substr( 0, Colon ) | TrimSpace;
+                auto FieldValue = Line.substr( Colon + 1 );
+
+                if( EqualIgnoreCase( FieldName, "Content-Type" ) )
+                {
+                    Result.ContentType = FieldValue | TrimSpace;
+                    continue;
+                }
+                if( ! EqualIgnoreCase( FieldName, "Content-Disposition" ) ) continue;
+
+                // form-data; name="field"; filename="a.txt"
+                FieldValue.remove_prefix( std::min( FieldValue.find( ';' ), FieldValue.length() ) );
+                while( ! FieldValue.empty() )
+                {
+                    FieldValue.remove_prefix( 1 );  // ';'
+                    auto Equal = FieldValue.find_first_of( "=;" );
+                    if( Equal == StrView::npos || FieldValue[Equal] == ';' )
+                    {
+                        FieldValue.remove_prefix( std::min( Equal, FieldValue.length() ) );
+                        continue;
+                    }
+                    auto ParamName = FieldValue.substr( 0, Equal ) | TrimSpace;
+                    FieldValue.remove_prefix( Equal + 1 );
+                    FieldValue = FieldValue.substr( std::min( FieldValue.find_first_not_of( " \t" ), FieldValue.length() ) );
+
+                    auto ParamValue = StrView{};
+                    if( FieldValue.starts_with( '"' ) )
+                    {
+                        auto Closing = std::min( FieldValue.find( '"', 1 ), FieldValue.length() );
+                        ParamValue = FieldValue.substr( 1, Closing - 1 );
+                        FieldValue.remove_prefix( std::min( Closing + 1, FieldValue.length() ) );
+                    }
+                    else
+                    {
+                        ParamValue = FieldValue.substr( 0, FieldValue.find( ';' ) ) | TrimSpace;
+                    }
+                    FieldValue.remove_prefix( std::min( FieldValue.find( ';' ), FieldValue.length() ) );
+
+                    if( EqualIgnoreCase( ParamName, "name" ) ) Result.Name = ParamValue;
+                    if( EqualIgnoreCase( ParamName, "filename" ) ) Result.FileName = ParamValue;
+                }
+            }
+            return Result;
+        }
+
+        // parts in order of appearance, Visitor( Name, FileName, ContentType, Content )
+        // linear in Payload, malformed tail ignored
+        static auto Scan( StrView ContentTypeField, StrView Payload, auto&& Visitor ) -> void
+        {
+            auto Boundary = BoundaryOf( ContentTypeField );
+            if( Boundary.empty() || Boundary.length() > BoundaryLengthLimit )  //
+                [[unlikely]]
+                return;
+
+            auto Searcher = DelimiterSearcher{ Boundary };
+            auto Delimiter = Searcher.Delimiter;
+
+            // first delimiter goes without leading CRLF, unless preceded by preamble
+            auto Cursor = Delimiter.length() - 2;
+            if( ! Payload.starts_with( Delimiter.substr( 2 ) ) )
+            {
+                Cursor = Searcher.Find( Payload, 0 );
+                if( Cursor == StrView::npos ) return;
+                Cursor += Delimiter.length();
+            }
+
+            while( true )
+            {
+                // after delimiter : "--" closes, otherwise transport padding then CRLF
+                auto Rest = Payload.substr( Cursor );
+                if( Rest.starts_with( "--" ) ) return;
+                Cursor += std::min( Rest.find_first_not_of( " \t" ), Rest.length() );
+                if( ! Payload.substr( Cursor ).starts_with( "\r\n" ) )  //
+                    [[unlikely]]
+                    return;
+                Cursor += 2;
+
+                auto PartEnd = Searcher.Find( Payload, Cursor );
+                if( PartEnd == StrView::npos )  //
+                    [[unlikely]]
+                    return;
+                auto Part = Payload.substr( Cursor, PartEnd - Cursor );
+                Cursor = PartEnd + Delimiter.length();
+
+                // part without header block has no name either, skipped
+                auto HeaderEnd = Part.find( "\r\n\r\n" );
+                if( HeaderEnd == StrView::npos )  //
+                    [[unlikely]]
+                    continue;
+                auto Header = ParseHeader( Part.substr( 0, HeaderEnd ) );
+                if( Header.Name.empty() )  //
+                    [[unlikely]]
+                    continue;
+
+                Visitor( Header.Name, Header.FileName, Header.ContentType, Part.substr( HeaderEnd + 4 ) );
+            }
+        }
+
+        // parts of an in-memory body, counted by delimiters only
+        static auto CountParts( StrView ContentTypeField, StrView Payload ) -> std::size_t
+        {
+            auto Boundary = BoundaryOf( ContentTypeField );
+            if( Boundary.empty() || Boundary.length() > BoundaryLengthLimit ) return 0;
+            auto Searcher = DelimiterSearcher{ Boundary };
+            auto Count = Payload.starts_with( Searcher.Delimiter.substr( 2 ) ) ? 1uz : 0uz;
+            for( auto Match = Searcher.Find( Payload, 0 ); Match != StrView::npos; Match = Searcher.Find( Payload, Match + Searcher.Delimiter.length() ) ) ++Count;
+            return Count - ( Count > 0 );  // closing delimiter
+        }
+    }  // namespace MultiPart
+
+    namespace FastCGI
+    {
+        constexpr auto ReadChunkSize = 64uz * 1024;
+        constexpr auto ReadRoundLimit = 16;  // per readiness event, keep other connections responsive
+        constexpr auto OutputFlushThreshold = 64uz * 1024;
+        constexpr auto WriteTimeout = 30s;
+        constexpr auto AcceptBackOff = 100ms;  // listener paused after running out of descriptors or memory
+        constexpr auto MaxConnectionsValue = "1024"sv;
+
+        static auto AppendRecord( std::string& Buffer, RecordType Type, std::uint16_t RequestId, StrView Content ) -> void
+        {
+            // Content must fit in a single record
+            auto Header = RecordHeader{ .Version = ProtocolVersion,
+                                        .Type = Type,
+                                        .RequestId = RequestId,
+                                        .ContentLength = static_cast<std::uint16_t>( Content.length() ),
+                                        .PaddingLength = static_cast<std::uint8_t>( ( 8 - Content.length() % 8 ) % 8 ) };
+            auto Offset = Buffer.length();
+            Buffer.resize( Offset + Header.RecordLength() );  // zero padding included
+            Header.Encode( Buffer.data() + Offset );
+            RNG::copy( Content, Buffer.data() + Offset + HeaderLength );
+        }
+
+        static auto AppendEndRequest( std::string& Buffer, std::uint16_t RequestId, std::uint32_t AppStatus, ProtocolStatus Status ) -> void
+        {
+            char Body[8] = { static_cast<char>( AppStatus >> 24 ), static_cast<char>( AppStatus >> 16 ),  //
+                             static_cast<char>( AppStatus >> 8 ), static_cast<char>( AppStatus ),          //
+                             static_cast<char>( Status ) };
+            AppendRecord( Buffer, RecordType::EndRequest, RequestId, { Body, sizeof( Body ) } );
+        }
+
+        static auto AppendParamLength( std::string& Buffer, std::size_t Length ) -> void
+        {
+            if( Length < 0x80 )
+            {
+                Buffer += static_cast<char>( Length );
+                return;
+            }
+            Buffer += static_cast<char>( Length >> 24 | 0x80 );
+            Buffer += static_cast<char>( Length >> 16 );
+            Buffer += static_cast<char>( Length >> 8 );
+            Buffer += static_cast<char>( Length );
+        }
+
+        static auto AppendParam( std::string& Buffer, StrView Name, StrView Value ) -> void
+        {
+            AppendParamLength( Buffer, Name.length() );
+            AppendParamLength( Buffer, Value.length() );
+            Buffer.append( Name ).append( Value );
+        }
+
+        // visit name-value pairs of PARAMS / GET_VALUES, false on malformed input
+        static auto DecodeParams( StrView Encoded, auto&& Visitor ) -> bool
+        {
+            auto NextLength = [&Encoded]( std::size_t& Length ) -> bool {
+                auto Byte = [&Encoded]( std::size_t Index ) -> std::size_t { return static_cast<unsigned char>( Encoded[Index] ); };
+                if( Encoded.empty() ) return false;
+                if( Byte( 0 ) < 0x80 )
+                {
+                    Length = Byte( 0 );
+                    Encoded.remove_prefix( 1 );
+                    return true;
+                }
+                if( Encoded.length() < 4 ) return false;
+                Length = ( Byte( 0 ) & 0x7F ) << 24 | Byte( 1 ) << 16 | Byte( 2 ) << 8 | Byte( 3 );
+                Encoded.remove_prefix( 4 );
+                return true;
+            };
+
+            while( ! Encoded.empty() )
+            {
+                auto NameLength = 0uz;
+                auto ValueLength = 0uz;
+                if( ! NextLength( NameLength ) || ! NextLength( ValueLength ) ) return false;
+                if( Encoded.length() < NameLength + ValueLength ) return false;
+                Visitor( Encoded.substr( 0, NameLength ), Encoded.substr( NameLength, ValueLength ) );
+                Encoded.remove_prefix( NameLength + ValueLength );
+            }
+            return true;
+        }
+
+        static auto BuildEnvironment( RequestContext& Context, StrView EncodedParams ) -> bool
+        {
+            auto& Buffer = Context.ParamBuffer;
+            auto Entries = std::vector<ParamSlot>{};
+            Buffer.clear();
+            Buffer.reserve( EncodedParams.length() );  // "NAME=VALUE\0" is never longer than its encoded form
+            auto Valid = DecodeParams( EncodedParams, [&]( StrView Name, StrView Value ) {
+                Entries.push_back( { .NameOffset = static_cast<std::uint32_t>( Buffer.length() ),
+                                     .NameLength = static_cast<std::uint32_t>( Name.length() ),
+                                     .ValueLength = static_cast<std::uint32_t>( Value.length() ) } );
+                Buffer.append( Name ).append( 1, '=' ).append( Value ).append( 1, '\0' );
+            } );
+
+            Context.Environment.clear();
+            for( const auto& E : Entries ) Context.Environment.push_back( Buffer.data() + E.NameOffset );
+            Context.Environment.push_back( nullptr );
+
+            // indexed once, lookups of the request then probe instead of scanning Environment
+            auto& Slots = Context.ParamIndex;
+            Slots.assign( std::max( 16uz, std::bit_ceil( Entries.size() * 2 ) ), ParamSlot{} );
+            for( auto& E : Entries )
+            {
+                auto Name = StrView{ Buffer.data() + E.NameOffset, E.NameLength };
+                auto Hash = ParseUtil::HashKey( Name );
+                E.HashTag = static_cast<std::uint32_t>( Hash >> 32 );
+                for( auto Slot = Hash & ( Slots.size() - 1 );; Slot = ( Slot + 1 ) & ( Slots.size() - 1 ) )
+                {
+                    auto& S = Slots[Slot];
+                    if( S.NameOffset == ParamSlot::Empty )
+                    {
+                        S = E;
+                        break;
+                    }
+                    if( S.HashTag == E.HashTag && StrView{ Buffer.data() + S.NameOffset, S.NameLength } == Name ) break;  // first one kept, as GetParam
+                }
+            }
+            return Valid;
+        }
+
+        auto GetParam( StrView Name, ParamArray Environment ) -> const char*
+        {
+            if( Environment == nullptr ) return nullptr;
+            for( ; *Environment != nullptr; ++Environment )
+            {
+                auto Entry = StrView{ *Environment };
+                if( Entry.length() > Name.length() && Entry[Name.length()] == '=' && Entry.starts_with( Name ) )  //
+                    return *Environment + Name.length() + 1;
+            }
+            return nullptr;
+        }
+
+        auto RequestContext::FindParam( ParseUtil::HashedKey Key ) const -> std::optional<StrView>
+        {
+            if( ParamIndex.empty() ) return std::nullopt;
+            auto Mask = ParamIndex.size() - 1;
+            for( auto Slot = Key.Hash & Mask; ParamIndex[Slot].NameOffset != ParamSlot::Empty; Slot = ( Slot + 1 ) & Mask )
+            {
+                const auto& S = ParamIndex[Slot];
+                if( S.HashTag == static_cast<std::uint32_t>( Key.Hash >> 32 ) &&  //
+                    StrView{ ParamBuffer.data() + S.NameOffset, S.NameLength } == Key.Name )
+                    return StrView{ ParamBuffer.data() + S.NameOffset + S.NameLength + 1, S.ValueLength };
+            }
+            return std::nullopt;
+        }
+
+        static auto ParamOf( const RequestContext& Context, StrView Name ) -> StrView
+        {
+            return Context.FindParam( ParseUtil::HashedKey{ Name } ).value_or( StrView{} );
+        }
+
+        // "k1=v1&k2=v2", not decoded
+        static auto CountPairs( StrView EncodedPairs ) -> std::size_t
+        {
+            return EncodedPairs.empty() ? 0 : static_cast<std::size_t>( RNG::count( EncodedPairs, '&' ) ) + 1;
+        }
+
+        // deepest nesting of objects and arrays, counting stops beyond Limit
+        static auto JsonDepth( StrView Body, std::size_t Limit ) -> std::size_t
+        {
+            auto Depth = 0uz;
+            auto Deepest = 0uz;
+            for( auto Index = Body.find_first_of( "\"{}[]" ); Index < Body.length() && Deepest <= Limit; Index = Body.find_first_of( "\"{}[]", Index + 1 ) )
+            {
+                switch( Body[Index] )
+                {
+                    case '"' :  // skip string, escaped quotes included
+                        while( ( Index = Body.find_first_of( "\"\\", Index + 1 ) ) < Body.length() && Body[Index] == '\\' ) ++Index;
+                        if( Index >= Body.length() ) return Deepest;  // unterminated, left to the Json parser to reject
+                        break;
+                    case '{' :
+                    case '[' : Deepest = std::max( Deepest, ++Depth ); break;
+                    default :  Depth -= Depth > 0; break;
+                }
+            }
+            return Deepest;
+        }
+
+        // limits of the route, checked as soon as params are complete
+        // Return: [ OK ] if within limits; status to reject with otherwise
+        static auto CheckParams( RequestContext& Context ) -> HTTP::StatusCode
+        {
+            auto Path = ParamOf( Context, "DOCUMENT_URI" );
+            auto& Limits = Context.Limits = LimitsOf( Path.empty() ? ParamOf( Context, "SCRIPT_NAME" ) : Path );
+            auto ContentLength = ParamOf( Context, "CONTENT_LENGTH" ) | ConvertTo<std::size_t> | ParseUtil::FallBack( 0uz );
+            if( Limits.MaxBodySize > 0 && ContentLength > Limits.MaxBodySize ) return HTTP::StatusCode::PayloadTooLarge;
+            if( Limits.MaxFields > 0 && CountPairs( ParamOf( Context, "QUERY_STRING" ) ) > Limits.MaxFields ) return HTTP::StatusCode::BadRequest;
+            return HTTP::StatusCode::OK;
+        }
+
+        // once body is complete, size already checked as it arrived, spooled parts counted as they arrived
+        static auto CheckBody( const RequestContext& Context ) -> HTTP::StatusCode
+        {
+            auto& Limits = Context.Limits;
+            auto ContentTypeField = ParamOf( Context, "CONTENT_TYPE" );
+            switch( HTTP::ContentType::FromStringView( ContentTypeField ) )
+            {
+                using enum HTTP::ContentType::EnumValue;
+                case APPLICATION_X_WWW_FORM_URLENCODED :
+                    if( Limits.MaxFields > 0 && CountPairs( ParamOf( Context, "QUERY_STRING" ) ) + CountPairs( Context.StdIn ) > Limits.MaxFields )
+                        return HTTP::StatusCode::BadRequest;
+                    break;
+                case MULTIPART_FORM_DATA :
+                    if( Limits.MaxFields > 0 && Context.Spool == nullptr && MultiPart::CountParts( ContentTypeField, Context.StdIn ) > Limits.MaxFields )
+                        return HTTP::StatusCode::BadRequest;
+                    break;
+                case APPLICATION_JSON :
+                    if( Limits.MaxJsonDepth > 0 && JsonDepth( Context.StdIn, Limits.MaxJsonDepth ) > Limits.MaxJsonDepth ) return HTTP::StatusCode::BadRequest;
+                    break;
+                default : break;
+            }
+            return HTTP::StatusCode::OK;
+        }
+
+        // FCGI_WEB_SERVER_ADDRS, unix socket connections always allowed
+        static auto WebServerAllowed( int FD ) -> bool
+        {
+            static auto AllowList = [] {
+                auto Result = std::vector<std::string>{};
+                if( auto Addresses = std::getenv( "FCGI_WEB_SERVER_ADDRS" ) )
+                    for( auto Address : StrView{ Addresses } | ParseUtil::SplitBy( ',' ) )
+                        if( auto First = Address.find_first_not_of( ' ' ); First != StrView::npos )
+                            Result.emplace_back( Address.substr( First, Address.find_last_not_of( ' ' ) - First + 1 ) );
+                return Result;
+            }();
+            if( AllowList.empty() ) return true;
+
+            auto PeerAddr = sockaddr_storage{};
+            auto PeerAddrLen = socklen_t{ sizeof( PeerAddr ) };
+            if( ::getpeername( FD, (sockaddr*)&PeerAddr, &PeerAddrLen ) != 0 ) return false;
+
+            char Host[INET6_ADDRSTRLEN]{};
+            switch( PeerAddr.ss_family )
+            {
+                case AF_UNIX : return true;
+                case AF_INET : ::inet_ntop( AF_INET, &reinterpret_cast<sockaddr_in&>( PeerAddr ).sin_addr, Host, sizeof( Host ) ); break;
+                case AF_INET6 :
+                {
+                    auto& Address = reinterpret_cast<sockaddr_in6&>( PeerAddr ).sin6_addr;
+                    if( IN6_IS_ADDR_V4MAPPED( &Address ) )  // dual stack listener
+                        ::inet_ntop( AF_INET, &Address.s6_addr[12], Host, sizeof( Host ) );
+                    else
+                        ::inet_ntop( AF_INET6, &Address, Host, sizeof( Host ) );
+                    break;
+                }
+                default : return false;
+            }
+            if( RNG::contains( AllowList, StrView{ Host } ) ) return true;
+            std::println( "[ Warning ] Connection from {} rejected, not in FCGI_WEB_SERVER_ADDRS", Host );
+            return false;
+        }
+
+        // BEGIN_REQUEST received, END_REQUEST not yet sent, across all listen sockets
+        static auto InFlightCount = std::atomic<std::size_t>{ 0 };
+        static auto RetireRequests( std::size_t Count ) -> void;  // wakes draining workers once nothing left in flight
+
+        // drain phase starts on first call after TerminationToken activated
+        static auto DrainDeadline() -> std::chrono::steady_clock::time_point
+        {
+            static auto Deadline = std::chrono::steady_clock::now() + Config::ShutdownGracePeriod;
+            return Deadline;
+        }
+
+        struct Connection
+        {
+            struct PendingRequest
+            {
+                std::unique_ptr<RequestContext> Context;
+                std::string EncodedParams{};
+            };
+
+            int FD;
+            std::mutex WriteMutex{};                  // guards Outgoing, held for non-blocking sends only
+            std::string Outgoing{};                   // whole records queued, sent from the front, keeps multiplexed STDOUT intact
+            std::uint64_t SentLength{};               // sent since accepted, tells a writer its records are out
+            int SendError{};                          // errno of the first failed send
+            bool ShutdownOnceSent{};
+            bool WatchingWritable{};                  // reactor only
+            std::atomic<int> ActiveRequests{ 0 };     // pending + in-flight
+            std::string ReadBuffer{};
+            std::unordered_map<std::uint16_t, PendingRequest> Pending{};  // requests being assembled by the reactor
+            std::mutex InFlightMutex{};
+            std::unordered_map<std::uint16_t, std::stop_source> InFlight{};  // requests handed to worker threads
+
+            explicit Connection( int FD ) : FD{ FD } {}
+            ~Connection()
+            {
+                if( ! Pending.empty() ) RetireRequests( Pending.size() );  // never completed
+                ::close( FD );
+            }
+
+            // FCGI_ABORT_REQUEST, or every in-flight request once upstream closes the connection
+            auto Cancel( std::optional<std::uint16_t> RequestId = std::nullopt ) -> void
+            {
+                auto Cancelled = std::vector<std::stop_source>{};
+                {
+                    auto Lock = std::lock_guard{ InFlightMutex };
+                    for( auto& [Id, Cancellation] : InFlight )
+                        if( ! RequestId || Id == *RequestId ) Cancelled.push_back( Cancellation );
+                }
+                for( auto& Cancellation : Cancelled ) Cancellation.request_stop();  // callbacks run outside the lock
+            }
+
+            // Return: stream position once Records are sent, see SendQueued
+            auto Enqueue( StrView Records ) -> std::uint64_t
+            {
+                auto Lock = std::lock_guard{ WriteMutex };
+                Outgoing += Records;
+                return SentLength + Outgoing.length();
+            }
+
+            // send what the socket takes now, never blocks
+            // Return: [ 0 ] once sent up to Position; [ EAGAIN ] if not yet; [ errno ] if connection failed
+            auto SendQueued( std::uint64_t Position = 0 ) -> int
+            {
+                auto Lock = std::lock_guard{ WriteMutex };
+                auto Queued = StrView{ Outgoing };
+                while( ! Queued.empty() && SendError == 0 )
+                {
+                    auto WrittenLength = ::send( FD, Queued.data(), Queued.length(), MSG_NOSIGNAL | MSG_DONTWAIT );
+                    if( WrittenLength >= 0 )
+                    {
+                        Queued.remove_prefix( WrittenLength );
+                        continue;
+                    }
+                    if( errno == EAGAIN || errno == EWOULDBLOCK ) break;
+                    if( errno != EINTR ) SendError = errno;
+                }
+                SentLength += Outgoing.length() - Queued.length();
+                Outgoing.erase( 0, Outgoing.length() - Queued.length() );
+                if( SendError != 0 ) return SendError;
+                if( Outgoing.empty() && std::exchange( ShutdownOnceSent, false ) ) ::shutdown( FD, SHUT_RDWR );
+                return SentLength >= Position ? 0 : EAGAIN;
+            }
+
+            auto HasQueued() -> bool
+            {
+                auto Lock = std::lock_guard{ WriteMutex };
+                return ! Outgoing.empty() && SendError == 0;
+            }
+
+            // upstream sees the queued records before the connection ends
+            auto ShutdownWhenSent() -> void
+            {
+                {
+                    auto Lock = std::lock_guard{ WriteMutex };
+                    ShutdownOnceSent = true;
+                }
+                SendQueued();
+            }
+
+            // reactor side, rest sent once the socket is writable
+            // Return: [ false ] if connection failed
+            auto Reply( StrView Records ) -> bool
+            {
+                auto Error = SendQueued( Enqueue( Records ) );
+                return Error == 0 || Error == EAGAIN;
+            }
+
+            // blocking write, for worker threads
+            // Return: [ 0 ] on success; [ errno ] otherwise
+            auto Write( StrView Records ) -> int
+            {
+                for( auto Position = Enqueue( Records );; )
+                {
+                    auto Error = SendQueued( Position );
+                    if( Error != EAGAIN ) return Error;
+
+                    auto WritablePoll = pollfd{ .fd = FD, .events = POLLOUT, .revents = 0 };
+                    auto PollResult = ::poll( &WritablePoll, 1, std::chrono::duration_cast<std::chrono::milliseconds>( WriteTimeout ).count() );
+                    if( PollResult == 0 ) return ETIMEDOUT;
+                    if( PollResult == -1 && errno != EINTR ) return errno;
+                }
+            }
+        };
+
+        // unnamed file in Config::UploadSpoolPath, memfd if the file system lacks O_TMPFILE
+        static auto OpenSpoolFile() -> int
+        {
+            auto FD = ::open( Config::UploadSpoolPath.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0666 );  // same mode as fopen once linked
+            if( FD == -1 ) FD = ::memfd_create( "EasyFCGI.upload", MFD_CLOEXEC );
+            return FD;
+        }
+
+        // multipart/form-data body parsed as STDIN records arrive
+        // parts with Content-Type written to spool files, other fields kept in memory
+        // buffered input stays below one record plus one delimiter, whatever the upload size
+        struct UploadSpool
+        {
+            constexpr static auto HeaderBlockLimit = 16uz * 1024;
+            enum class Stage : unsigned char { Preamble, Delimiter, Header, Body, Done };
+
+            struct Part
+            {
+                std::string Name{};
+                std::string FileName{};
+                std::string ContentType{};
+                std::string Content{};  // field value
+                int FD{ -1 };           // spool file of file part
+                std::size_t Length{};
+                const char* Mapping{};  // FD mapped once Request::Files is first accessed, pages read as touched
+
+                Part() = default;
+                Part( const Part& ) = delete;
+                ~Part()
+                {
+                    if( Mapping != nullptr ) ::munmap( const_cast<char*>( Mapping ), Length );
+                    if( FD != -1 ) ::close( FD );
+                }
+
+                auto View() -> StrView
+                {
+                    if( FD == -1 ) return Content;
+                    if( Mapping == nullptr && Length > 0 )
+                        if( auto Address = ::mmap( nullptr, Length, PROT_READ, MAP_SHARED, FD, 0 ); Address != MAP_FAILED )  //
+                            Mapping = static_cast<const char*>( Address );
+                    return Mapping == nullptr ? StrView{} : StrView{ Mapping, Length };
+                }
+            };
+
+            MultiPart::DelimiterSearcher Searcher;
+            Stage Progress{ Stage::Preamble };
+            std::string Window{ "\r\n" };  // first delimiter goes without leading CRLF
+            std::deque<Part> Parts{};        // address stable, viewed by Request::Query and Request::Files
+            Part* Current{};                 // null while skipping a part without name
+            int Error{};                     // errno of the first failed write
+            std::size_t MaxParts{};          // 0 for unlimited
+            std::size_t MaxFieldSize{};      // of a part kept in memory, 0 for unlimited
+            bool Overflow{};                 // more than MaxParts parts, rest of body dropped
+            bool FieldTooLarge{};            // part kept in memory beyond MaxFieldSize, rest of body dropped
+
+            explicit UploadSpool( StrView Boundary, const RequestLimits& Limits )
+                : Searcher{ Boundary }, MaxParts{ Limits.MaxFields }, MaxFieldSize{ Limits.MaxFieldSize }
+            {}
+
+            auto Emit( StrView Content ) -> void
+            {
+                if( Current == nullptr || Content.empty() ) return;
+                if( Current->FD == -1 )  // field, or file part whose spool file failed to open
+                {
+                    if( MaxFieldSize > 0 && Current->Content.length() + Content.length() > MaxFieldSize )
+                    {
+                        FieldTooLarge = true;
+                        Progress = Stage::Done;
+                        return;
+                    }
+                    Current->Content += Content;
+                    return;
+                }
+                Current->Length += Content.length();
+                while( ! Content.empty() )
+                {
+                    auto Written = ::write( Current->FD, Content.data(), Content.length() );
+                    if( Written < 0 && errno == EINTR ) continue;
+                    if( Written <= 0 )
+                    {
+                        Error = Written < 0 ? errno : ENOSPC;
+                        std::println( "[ Error {} ] {}\n Fail to spool upload [ {} ], rest of body dropped", Error, strerrordesc_np( Error ), Current->Name );
+                        Progress = Stage::Done;
+                        return;
+                    }
+                    Content.remove_prefix( static_cast<std::size_t>( Written ) );
+                }
+            }
+
+            auto Feed( StrView Input ) -> void
+            {
+                if( Progress == Stage::Done ) return;
+                Window += Input;
+                auto DelimiterLength = Searcher.Delimiter.length();
+                auto Consumed = 0uz;
+                auto Rest = [&] { return StrView{ Window }.substr( Consumed ); };
+                while( Progress != Stage::Done )
+                {
+                    if( Progress == Stage::Preamble || Progress == Stage::Body )
+                    {
+                        auto Match = Searcher.Find( Rest(), 0 );
+                        if( Match == StrView::npos )
+                        {
+                            // tail may hold the start of a delimiter
+                            auto Safe = Rest().length() - std::min( Rest().length(), DelimiterLength - 1 );
+                            if( Progress == Stage::Body ) Emit( Rest().substr( 0, Safe ) );
+                            Consumed += Safe;
+                            break;
+                        }
+                        if( Progress == Stage::Body ) Emit( Rest().substr( 0, Match ) );
+                        Consumed += Match + DelimiterLength;
+                        Current = nullptr;
+                        Progress = Stage::Delimiter;
+                        continue;
+                    }
+                    if( Progress == Stage::Delimiter )
+                    {
+                        // "--" closes, otherwise transport padding then CRLF
+                        if( Rest().length() < 2 ) break;
+                        if( Rest().starts_with( "--" ) )
+                        {
+                            Progress = Stage::Done;
+                            break;
+                        }
+                        auto LineEnd = Rest().find( "\r\n" );
+                        if( LineEnd == StrView::npos )
+                        {
+                            if( Rest().substr( 0, Rest().length() - Rest().ends_with( '\r' ) ).find_first_not_of( " \t" ) != StrView::npos )  //
+                                Progress = Stage::Done;  // malformed, CR of CRLF may still be alone
+                            break;
+                        }
+                        if( Rest().substr( 0, LineEnd ).find_first_not_of( " \t" ) != StrView::npos )
+                        {
+                            Progress = Stage::Done;
+                            break;
+                        }
+                        Consumed += LineEnd + 2;
+                        Progress = Stage::Header;
+                        continue;
+                    }
+                    // Stage::Header
+                    auto HeaderEnd = Rest().find( "\r\n\r\n" );
+                    if( HeaderEnd == StrView::npos )
+                    {
+                        if( Rest().length() > HeaderBlockLimit ) Progress = Stage::Done;
+                        break;
+                    }
+                    auto Header = MultiPart::ParseHeader( Rest().substr( 0, HeaderEnd ) );
+                    Consumed += HeaderEnd + 4;
+                    Progress = Stage::Body;
+                    if( Header.Name.empty() ) continue;
+                    if( MaxParts > 0 && Parts.size() >= MaxParts )
+                    {
+                        Overflow = true;
+                        Progress = Stage::Done;
+                        break;
+                    }
+
+                    Current = &Parts.emplace_back();
+                    Current->Name = Header.Name;
+                    Current->FileName = Header.FileName;
+                    Current->ContentType = Header.ContentType;
+                    if( ! Header.ContentType.empty() && ( Current->FD = OpenSpoolFile() ) == -1 )
+                        std::println( "[ Error {} ] {}\n Fail to open spool file, upload [ {} ] kept in memory", errno, strerrordesc_np( errno ), Current->Name );
+                }
+                if( Progress == Stage::Done )
+                    Window.clear();
+                else
+                    Window.erase( 0, Consumed );
+            }
+        };
+
+        // minimal io_uring binding on raw syscalls, created and driven by the reactor thread only
+        struct Uring
+        {
+            static constexpr auto QueueDepth = 256u;
+            static constexpr auto BufferGroup = std::uint16_t{ 0 };
+            static constexpr auto BufferCount = 64u;  // power of 2
+            static constexpr auto BufferSize = 16uz * 1024;
+
+            int FD{ -1 };
+            io_uring_params Params{};
+            void* RingMap{ MAP_FAILED };  // SQ and CQ rings share one mapping
+            std::size_t RingMapLength{};
+            void* SQEMap{ MAP_FAILED };
+            std::size_t SQEMapLength{};
+            void* BufferMap{ MAP_FAILED };  // provided buffer ring followed by buffer pool
+            std::size_t BufferMapLength{};
+            std::uint32_t SQTail{};
+            std::uint16_t BufferTail{};
+
+            Uring() = default;
+            Uring( const Uring& ) = delete;
+            ~Uring();
+
+            // Return: [ nullptr ] if kernel lacks the required features, errno set
+            static auto Create() -> std::unique_ptr<Uring>;
+
+            auto RingField( std::uint32_t Offset ) -> std::uint32_t& { return *reinterpret_cast<std::uint32_t*>( static_cast<char*>( RingMap ) + Offset ); }
+            auto BufferRing() -> io_uring_buf_ring* { return static_cast<io_uring_buf_ring*>( BufferMap ); }
+            auto BufferData( std::uint16_t BufferId ) -> char*
+            {
+                return static_cast<char*>( BufferMap ) + ::sysconf( _SC_PAGESIZE ) + BufferId * BufferSize;
+            }
+
+            // submit prepared entries, then wait for at least WaitCount completions
+            // Return: [ -1 ] on failure, errno set
+            auto Submit( unsigned WaitCount ) -> int;
+            auto NextSQE() -> io_uring_sqe&;
+            auto RecycleBuffer( std::uint16_t BufferId ) -> void;
+
+            auto PrepareMultishotAccept( int ListenFD, std::uint64_t UserData ) -> void;
+            auto PrepareMultishotPoll( int FD, std::uint64_t UserData ) -> void;
+            auto PreparePoll( int FD, std::uint32_t Events, std::uint64_t UserData ) -> void;  // one completion
+            auto PrepareMultishotReceive( int FD, std::uint64_t UserData ) -> void;
+            auto PrepareCancel( std::uint64_t TargetUserData, std::uint64_t UserData ) -> void;
+            auto PrepareTimeout( const __kernel_timespec&, std::uint64_t UserData ) -> void;  // timespec read at submission
+
+            auto ForEachCompletion( auto&& Visitor ) -> void
+            {
+                auto Head = RingField( Params.cq_off.head );
+                auto Tail = std::atomic_ref{ RingField( Params.cq_off.tail ) }.load( std::memory_order_acquire );
+                auto Mask = RingField( Params.cq_off.ring_mask );
+                auto CQEs = reinterpret_cast<io_uring_cqe*>( static_cast<char*>( RingMap ) + Params.cq_off.cqes );
+                for( ; Head != Tail; ++Head ) Visitor( io_uring_cqe{ CQEs[Head & Mask] } );
+                std::atomic_ref{ RingField( Params.cq_off.head ) }.store( Head, std::memory_order_release );
+            }
+        };
+
+        Uring::~Uring()
+        {
+            if( BufferMap != MAP_FAILED ) ::munmap( BufferMap, BufferMapLength );
+            if( SQEMap != MAP_FAILED ) ::munmap( SQEMap, SQEMapLength );
+            if( RingMap != MAP_FAILED ) ::munmap( RingMap, RingMapLength );
+            if( FD != -1 ) ::close( FD );
+        }
+
+        auto Uring::Create() -> std::unique_ptr<Uring>
+        {
+            auto Ring = std::make_unique<Uring>();
+            auto& Params = Ring->Params;
+            Params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SINGLE_ISSUER;
+            Params.cq_entries = QueueDepth * 4;  // multishot requests post many completions per submission
+            Ring->FD = static_cast<int>( ::syscall( __NR_io_uring_setup, QueueDepth, &Params ) );
+            if( Ring->FD == -1 ) return nullptr;
+            if( ! ( Params.features & IORING_FEAT_SINGLE_MMAP ) || ! ( Params.features & IORING_FEAT_NODROP ) )
+            {
+                errno = ENOTSUP;
+                return nullptr;
+            }
+
+            Ring->RingMapLength = std::max( Params.sq_off.array + Params.sq_entries * sizeof( std::uint32_t ),  //
+                                            Params.cq_off.cqes + Params.cq_entries * sizeof( io_uring_cqe ) );
+            Ring->RingMap = ::mmap( nullptr, Ring->RingMapLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring->FD, IORING_OFF_SQ_RING );
+            Ring->SQEMapLength = Params.sq_entries * sizeof( io_uring_sqe );
+            Ring->SQEMap = ::mmap( nullptr, Ring->SQEMapLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring->FD, IORING_OFF_SQES );
+            if( Ring->RingMap == MAP_FAILED || Ring->SQEMap == MAP_FAILED ) return nullptr;
+
+            // SQ index array is an identity mapping, filled once
+            auto SQArray = &Ring->RingField( Params.sq_off.array );
+            for( auto Index : VIEW::iota( 0u, Params.sq_entries ) ) SQArray[Index] = Index;
+            Ring->SQTail = Ring->RingField( Params.sq_off.tail );
+
+            // provided buffer ring, kernel picks a buffer for each multishot receive completion
+            Ring->BufferMapLength = ::sysconf( _SC_PAGESIZE ) + BufferCount * BufferSize;
+            Ring->BufferMap = ::mmap( nullptr, Ring->BufferMapLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+            if( Ring->BufferMap == MAP_FAILED ) return nullptr;
+            auto Registration = io_uring_buf_reg{ .ring_addr = reinterpret_cast<std::uint64_t>( Ring->BufferMap ),
+                                                  .ring_entries = BufferCount,
+                                                  .bgid = BufferGroup,
+                                                  .pad = 0,
+                                                  .resv = {} };
+            if( ::syscall( __NR_io_uring_register, Ring->FD, IORING_REGISTER_PBUF_RING, &Registration, 1 ) == -1 ) return nullptr;
+            for( auto BufferId : VIEW::iota( 0u, BufferCount ) ) Ring->RecycleBuffer( static_cast<std::uint16_t>( BufferId ) );
+
+            return Ring;
+        }
+
+        auto Uring::Submit( unsigned WaitCount ) -> int
+        {
+            std::atomic_ref{ RingField( Params.sq_off.tail ) }.store( SQTail, std::memory_order_release );
+            auto Unsubmitted = SQTail - std::atomic_ref{ RingField( Params.sq_off.head ) }.load( std::memory_order_acquire );
+            return static_cast<int>( ::syscall( __NR_io_uring_enter, FD, Unsubmitted, WaitCount, WaitCount > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0 ) );
+        }
+
+        auto Uring::NextSQE() -> io_uring_sqe&
+        {
+            while( SQTail - std::atomic_ref{ RingField( Params.sq_off.head ) }.load( std::memory_order_acquire ) >= Params.sq_entries )  //
+                Submit( 0 );
+            auto& SQE = static_cast<io_uring_sqe*>( SQEMap )[SQTail++ & RingField( Params.sq_off.ring_mask )];
+            SQE = io_uring_sqe{};
+            return SQE;
+        }
+
+        auto Uring::RecycleBuffer( std::uint16_t BufferId ) -> void
+        {
+            // tail overlays first slot's resv, fields assigned one by one
+            // slots addressed from mapping directly, flexible array member bufs is offset by an empty struct in C++
+            auto& Slot = static_cast<io_uring_buf*>( BufferMap )[BufferTail & ( BufferCount - 1 )];
+            Slot.addr = reinterpret_cast<std::uint64_t>( BufferData( BufferId ) );
+            Slot.len = BufferSize;
+            Slot.bid = BufferId;
+            std::atomic_ref{ BufferRing()->tail }.store( ++BufferTail, std::memory_order_release );
+        }
+
+        auto Uring::PrepareMultishotAccept( int ListenFD, std::uint64_t UserData ) -> void
+        {
+            auto& SQE = NextSQE();
+            SQE.opcode = IORING_OP_ACCEPT;
+            SQE.fd = ListenFD;
+            SQE.ioprio = IORING_ACCEPT_MULTISHOT;
+            SQE.accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+            SQE.user_data = UserData;
+        }
+
+        auto Uring::PrepareMultishotPoll( int FD, std::uint64_t UserData ) -> void
+        {
+            auto& SQE = NextSQE();
+            SQE.opcode = IORING_OP_POLL_ADD;
+            SQE.fd = FD;
+            SQE.len = IORING_POLL_ADD_MULTI;
+            SQE.poll32_events = POLLIN;
+            SQE.user_data = UserData;
+        }
+
+        auto Uring::PreparePoll( int FD, std::uint32_t Events, std::uint64_t UserData ) -> void
+        {
+            auto& SQE = NextSQE();
+            SQE.opcode = IORING_OP_POLL_ADD;
+            SQE.fd = FD;
+            SQE.poll32_events = Events;
+            SQE.user_data = UserData;
+        }
+
+        auto Uring::PrepareMultishotReceive( int FD, std::uint64_t UserData ) -> void
+        {
+            auto& SQE = NextSQE();
+            SQE.opcode = IORING_OP_RECV;
+            SQE.fd = FD;
+            SQE.flags = IOSQE_BUFFER_SELECT;
+            SQE.ioprio = IORING_RECV_MULTISHOT;
+            SQE.buf_group = BufferGroup;
+            SQE.user_data = UserData;
+        }
+
+        auto Uring::PrepareCancel( std::uint64_t TargetUserData, std::uint64_t UserData ) -> void
+        {
+            auto& SQE = NextSQE();
+            SQE.opcode = IORING_OP_ASYNC_CANCEL;
+            SQE.fd = -1;
+            SQE.addr = TargetUserData;
+            SQE.user_data = UserData;
+        }
+
+        auto Uring::PrepareTimeout( const __kernel_timespec& Duration, std::uint64_t UserData ) -> void
+        {
+            auto& SQE = NextSQE();
+            SQE.opcode = IORING_OP_TIMEOUT;
+            SQE.fd = -1;
+            SQE.addr = reinterpret_cast<std::uint64_t>( &Duration );
+            SQE.len = 1;
+            SQE.user_data = UserData;
+        }
+
+        // one reactor thread per listen socket, assembling requests for worker threads
+        struct Engine
+        {
+            using ConnectionMap = std::unordered_map<int, std::shared_ptr<Connection>>;
+
+            SocketFileDescriptor ListenSocket;
+            int EpollFD;
+            int WakeFD;
+            int TimerFD;  // earliest request deadline, on CLOCK_MONOTONIC as steady_clock
+            std::mutex DeadlineMutex{};
+            std::multimap<std::chrono::steady_clock::time_point, std::stop_source> Deadlines{};  // per request, see Request::StopToken
+            std::mutex ReadyMutex{};
+            std::condition_variable_any ReadyCV{};
+            std::deque<std::unique_ptr<RequestContext>> ReadyQueue{};
+            std::jthread Reactor{};
+
+            explicit Engine( SocketFileDescriptor );
+            ~Engine();
+
+            static auto Attach( SocketFileDescriptor ) -> Engine&;
+            static auto NotifyDrained() -> void;
+
+            auto PinReactor( int CPU ) -> void;
+
+            // block until a complete request is available
+            // Return: [ nullptr ] if TerminationToken activated
+            auto NextRequest() -> std::unique_ptr<RequestContext>;
+
+            auto Watch( int FD, std::uint32_t Events ) -> void;
+            auto Wake() -> void;
+            auto AddDeadline( std::chrono::steady_clock::time_point, std::stop_source ) -> void;
+            auto RemoveDeadline( std::chrono::steady_clock::time_point, const std::stop_source& ) -> void;
+            auto ArmDeadlineTimer() -> void;  // DeadlineMutex held
+            auto ExpireDeadlines() -> void;
+            auto ReactorLoop( std::stop_token ) -> void;
+            auto EpollLoop( std::stop_token ) -> void;
+            auto UringLoop( std::stop_token, Uring& ) -> void;
+            auto WatchWritable( Connection& ) -> void;
+            auto AcceptConnections( ConnectionMap& ) -> bool;  // Return: [ false ] if listener taken off epoll for AcceptBackOff
+            auto BeginDrain( ConnectionMap& ) -> void;
+            auto ReadRecords( const std::shared_ptr<Connection>& ) -> bool;
+            auto ProcessRecords( const std::shared_ptr<Connection>& ) -> bool;
+            auto HandleRecord( const std::shared_ptr<Connection>&, RecordHeader, StrView ) -> bool;
+            auto HandleManagementRecord( Connection&, RecordHeader, StrView ) -> void;
+            auto Reject( const std::shared_ptr<Connection>&, std::uint16_t RequestId, HTTP::StatusCode ) -> bool;
+            auto RespondPending( const std::shared_ptr<Connection>&, std::uint16_t RequestId, StrView Reply ) -> bool;  // Reply ends with END_REQUEST
+            auto DispatchPending( const std::shared_ptr<Connection>&, std::unique_ptr<RequestContext> ) -> void;
+        };
+
+        Engine::Engine( SocketFileDescriptor ListenSocket )
+            : ListenSocket{ ListenSocket },
+              EpollFD{ ::epoll_create1( EPOLL_CLOEXEC ) },
+              WakeFD{ ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) },
+              TimerFD{ ::timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC ) }
+        {
+            if( EpollFD == -1 || WakeFD == -1 || TimerFD == -1 )
+            {
+                std::println( "[ Fatal ] [ Error {} ] {}\n Fail to set up FastCGI reactor", errno, strerrordesc_np( errno ) );
+                std::exit( errno );
+            }
+            ::fcntl( ListenSocket, F_SETFL, ::fcntl( ListenSocket, F_GETFL ) | O_NONBLOCK );
+            Reactor = std::jthread{ [this]( std::stop_token StopToken ) { ReactorLoop( StopToken ); } };
+        }
+
+        Engine::~Engine()
+        {
+            Reactor.request_stop();
+            if( Reactor.joinable() ) Reactor.join();
+            ::close( EpollFD );
+            ::close( WakeFD );
+            ::close( TimerFD );
+        }
+
+        static auto EngineRegistryMutex = std::mutex{};
+        static auto EngineRegistry = std::map<SocketFileDescriptor, std::unique_ptr<Engine>>{};
+
+        auto Engine::Attach( SocketFileDescriptor ListenSocket ) -> Engine&
+        {
+            auto Lock = std::lock_guard{ EngineRegistryMutex };
+            auto& Slot = EngineRegistry[ListenSocket];
+            if( Slot == nullptr ) Slot = std::make_unique<Engine>( ListenSocket );
+            return *Slot;
+        }
+
+        auto Engine::PinReactor( int CPU ) -> void
+        {
+            auto CPUSet = cpu_set_t{};
+            CPU_ZERO( &CPUSet );
+            CPU_SET( CPU, &CPUSet );
+            if( auto Error = ::pthread_setaffinity_np( Reactor.native_handle(), sizeof( CPUSet ), &CPUSet ); Error != 0 )
+                std::println( "[ Error {} ] {}\n Fail to pin reactor thread to CPU {}", Error, strerrordesc_np( Error ), CPU );
+        }
+
+        auto Engine::NotifyDrained() -> void
+        {
+            auto Lock = std::lock_guard{ EngineRegistryMutex };
+            for( auto& [ListenSocket, EnginePtr] : EngineRegistry )
+            {
+                {
+                    auto ReadyLock = std::lock_guard{ EnginePtr->ReadyMutex };  // no lost wake-up between predicate check and wait
+                }
+                EnginePtr->ReadyCV.notify_all();
+            }
+        }
+
+        static auto RetireRequests( std::size_t Count ) -> void
+        {
+            if( InFlightCount.fetch_sub( Count ) == Count && TerminationRequested() ) Engine::NotifyDrained();
+        }
+
+        auto Engine::NextRequest() -> std::unique_ptr<RequestContext>
+        {
+            auto Lock = std::unique_lock{ ReadyMutex };
+            if( ! ReadyCV.wait( Lock, TerminationToken, [this] { return ! ReadyQueue.empty(); } ) )
+            {
+                // draining, serve what upstream has sent already until nothing left in flight or grace period over
+                ReadyCV.wait_until( Lock, DrainDeadline(), [this] { return ! ReadyQueue.empty() || InFlightCount == 0; } );
+                if( ReadyQueue.empty() ) return nullptr;
+            }
+            auto Next = std::move( ReadyQueue.front() );
+            ReadyQueue.pop_front();
+            return Next;
+        }
+
+        auto Engine::Watch( int FD, std::uint32_t Events ) -> void
+        {
+            auto Event = epoll_event{ .events = Events, .data = { .fd = FD } };
+            if( ::epoll_ctl( EpollFD, EPOLL_CTL_ADD, FD, &Event ) == -1 )  //
+                std::println( "[ Error {} ] {}\n Fail to watch file descriptor {}", errno, strerrordesc_np( errno ), FD );
+        }
+
+        // EPOLLOUT only while replies wait for the socket, level triggered it would fire continuously otherwise
+        auto Engine::WatchWritable( Connection& Upstream ) -> void
+        {
+            auto Queued = Upstream.HasQueued();
+            if( Queued == std::exchange( Upstream.WatchingWritable, Queued ) ) return;
+            auto Event = epoll_event{ .events = EPOLLIN | EPOLLRDHUP | ( Queued ? EPOLLOUT : 0u ), .data = { .fd = Upstream.FD } };
+            ::epoll_ctl( EpollFD, EPOLL_CTL_MOD, Upstream.FD, &Event );
+        }
+
+        auto Engine::Wake() -> void { ::eventfd_write( WakeFD, 1 ); }  // async-signal-safe
+
+        auto Engine::AddDeadline( std::chrono::steady_clock::time_point Deadline, std::stop_source Cancellation ) -> void
+        {
+            auto Lock = std::lock_guard{ DeadlineMutex };
+            if( Deadlines.emplace( Deadline, std::move( Cancellation ) ) == Deadlines.begin() ) ArmDeadlineTimer();
+        }
+
+        // timer left armed, an early expiry finds nothing due and rearms
+        auto Engine::RemoveDeadline( std::chrono::steady_clock::time_point Deadline, const std::stop_source& Cancellation ) -> void
+        {
+            auto Lock = std::lock_guard{ DeadlineMutex };
+            for( auto [Current, End] = Deadlines.equal_range( Deadline ); Current != End; ++Current )
+                if( Current->second == Cancellation )
+                {
+                    Deadlines.erase( Current );
+                    return;
+                }
+        }
+
+        auto Engine::ArmDeadlineTimer() -> void
+        {
+            auto Expiry = itimerspec{};  // all zero disarms
+            if( ! Deadlines.empty() )
+            {
+                auto SinceBoot = std::max( Deadlines.begin()->first.time_since_epoch(), std::chrono::steady_clock::duration{ 1 } );
+                auto Seconds = std::chrono::duration_cast<std::chrono::seconds>( SinceBoot );
+                Expiry.it_value = { .tv_sec = Seconds.count(), .tv_nsec = std::chrono::nanoseconds{ SinceBoot - Seconds }.count() };
+            }
+            ::timerfd_settime( TimerFD, TFD_TIMER_ABSTIME, &Expiry, nullptr );
+        }
+
+        auto Engine::ExpireDeadlines() -> void
+        {
+            auto Discard = std::uint64_t{};
+            std::ignore = ::read( TimerFD, &Discard, sizeof( Discard ) );
+            auto Cancelled = std::vector<std::stop_source>{};
+            {
+                auto Lock = std::lock_guard{ DeadlineMutex };
+                auto Expired = Deadlines.upper_bound( std::chrono::steady_clock::now() );
+                Cancelled = RNG::subrange( Deadlines.begin(), Expired ) | VIEW::values | RNG::to<std::vector>();
+                Deadlines.erase( Deadlines.begin(), Expired );
+                ArmDeadlineTimer();
+            }
+            for( auto& Cancellation : Cancelled ) Cancellation.request_stop();  // callbacks may set deadlines of other requests
+        }
+
+        auto Engine::ReactorLoop( std::stop_token StopToken ) -> void
+        {
+            auto WakeOnStop = std::stop_callback{ StopToken, [this] { Wake(); } };
+            auto WakeOnTermination = std::stop_callback{ TerminationToken, [this] { Wake(); } };
+            if( Config::UseIOUring )
+            {
+                // ring owned by reactor thread, required by IORING_SETUP_SINGLE_ISSUER
+                if( auto Ring = Uring::Create() ) return UringLoop( StopToken, *Ring );
+                std::println( "[ Error {} ] {}\n io_uring unavailable, fall back to epoll", errno, strerrordesc_np( errno ) );
+            }
+            EpollLoop( StopToken );
+        }
+
+        auto Engine::EpollLoop( std::stop_token StopToken ) -> void
+        {
+            Watch( ListenSocket, EPOLLIN | EPOLLEXCLUSIVE );  // avoid thundering herd among prefork workers
+            Watch( WakeFD, EPOLLIN );
+            Watch( TimerFD, EPOLLIN );
+            auto Connections = ConnectionMap{};
+            auto Events = std::array<epoll_event, 256>{};
+            auto Draining = false;
+            auto GracePeriodOver = false;
+            auto AcceptResumeTime = std::optional<std::chrono::steady_clock::time_point>{};  // listener off epoll until then
+
+            while( ! StopToken.stop_requested() )
+            {
+                if( TerminationRequested() && ! std::exchange( Draining, true ) )
+                {
+                    ::epoll_ctl( EpollFD, EPOLL_CTL_DEL, ListenSocket, nullptr );  // left in backlog for other processes
+                    AcceptResumeTime.reset();
+                    BeginDrain( Connections );
+                }
+                if( Draining && ! GracePeriodOver && std::chrono::steady_clock::now() >= DrainDeadline() )
+                {
+                    GracePeriodOver = true;
+                    for( auto& [FD, ConnectionPtr] : Connections ) ConnectionPtr->Cancel();
+                }
+                if( AcceptResumeTime && std::chrono::steady_clock::now() >= *AcceptResumeTime )
+                {
+                    AcceptResumeTime.reset();
+                    Watch( ListenSocket, EPOLLIN | EPOLLEXCLUSIVE );
+                }
+
+                auto WakeTime = AcceptResumeTime.value_or( std::chrono::steady_clock::time_point::max() );
+                if( Draining && ! GracePeriodOver ) WakeTime = std::min( WakeTime, DrainDeadline() );
+                auto Timeout = -1;
+                if( WakeTime != std::chrono::steady_clock::time_point::max() )
+                {
+                    auto Remaining = std::chrono::ceil<std::chrono::milliseconds>( WakeTime - std::chrono::steady_clock::now() );
+                    Timeout = static_cast<int>( std::clamp<std::chrono::milliseconds::rep>( Remaining.count(), 0, std::numeric_limits<int>::max() ) );
+                }
+                auto EventCount = ::epoll_wait( EpollFD, Events.data(), Events.size(), Timeout );
+                if( EventCount == -1 )
+                {
+                    if( errno == EINTR ) continue;
+                    std::println( "[ Error {} ] {}\n FastCGI reactor stopped", errno, strerrordesc_np( errno ) );
+                    break;
+                }
+
+                for( const auto& Event : Events | VIEW::take( EventCount ) )
+                {
+                    auto FD = Event.data.fd;
+                    if( FD == WakeFD )
+                    {
+                        auto Discard = eventfd_t{};
+                        ::eventfd_read( WakeFD, &Discard );
+                        continue;
+                    }
+                    if( FD == TimerFD )
+                    {
+                        ExpireDeadlines();
+                        continue;
+                    }
+                    if( FD == ListenSocket )
+                    {
+                        if( ! Draining && ! AcceptConnections( Connections ) ) AcceptResumeTime = std::chrono::steady_clock::now() + AcceptBackOff;
+                        continue;
+                    }
+
+                    auto Found = Connections.find( FD );
+                    if( Found == Connections.end() ) continue;
+                    auto& ConnectionPtr = Found->second;
+                    if( ( ! ( Event.events & EPOLLOUT ) || ConnectionPtr->SendQueued() == 0 ) &&  //
+                        ( ! ( Event.events & ( EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR ) ) || ReadRecords( ConnectionPtr ) ) )
+                    {
+                        WatchWritable( *ConnectionPtr );
+                        continue;
+                    }
+                    ::epoll_ctl( EpollFD, EPOLL_CTL_DEL, FD, nullptr );
+                    ConnectionPtr->Cancel();
+                    Connections.erase( Found );  // socket closed once the in-flight request, if any, releases it
+                }
+            }
+        }
+
+        auto Engine::UringLoop( std::stop_token StopToken, Uring& Ring ) -> void
+        {
+            enum Completion : std::uint64_t { AcceptCompletion, WakeCompletion, DeadlineCompletion, ReceiveCompletion, WritableCompletion, CancelCompletion, GracePeriodCompletion, AcceptBackOffCompletion };
+            auto Tag = []( Completion Kind, int FD ) { return Kind << 32 | static_cast<std::uint32_t>( FD ); };
+            auto Connections = ConnectionMap{};
+            auto Draining = false;
+            auto GracePeriod = __kernel_timespec{};
+            constexpr auto BackOff = __kernel_timespec{ .tv_sec = 0, .tv_nsec = std::chrono::nanoseconds{ AcceptBackOff }.count() };
+            auto AcceptPaused = false;
+
+            // all preparations of one round go to kernel in the io_uring_enter that also waits
+            Ring.PrepareMultishotAccept( ListenSocket, Tag( AcceptCompletion, ListenSocket ) );
+            Ring.PrepareMultishotPoll( WakeFD, Tag( WakeCompletion, WakeFD ) );
+            Ring.PrepareMultishotPoll( TimerFD, Tag( DeadlineCompletion, TimerFD ) );
+
+            auto OnAccept = [&]( const io_uring_cqe& CQE ) {
+                if( CQE.res >= 0 && ! WebServerAllowed( CQE.res ) )
+                {
+                    ::close( CQE.res );
+                }
+                else if( CQE.res >= 0 )
+                {
+                    Connections.insert_or_assign( CQE.res, std::make_shared<Connection>( CQE.res ) );
+                    Ring.PrepareMultishotReceive( CQE.res, Tag( ReceiveCompletion, CQE.res ) );
+                }
+                else switch( -CQE.res )
+                {
+                    case ECANCELED :    return;  // draining
+                    case EINTR :
+                    case ECONNABORTED : break;
+                    case EMFILE :
+                    case ENFILE :
+                    case ENOBUFS :
+                    case ENOMEM :
+                        // accepting again at once would only fail again, re-armed once the back-off expires
+                        if( std::exchange( AcceptPaused, true ) ) return;
+                        std::println( "[ Error {} ] {}\n Fail to accept connection, pause accepting for {}", -CQE.res, strerrordesc_np( -CQE.res ), AcceptBackOff );
+                        if( CQE.flags & IORING_CQE_F_MORE ) Ring.PrepareCancel( Tag( AcceptCompletion, ListenSocket ), Tag( CancelCompletion, ListenSocket ) );
+                        return Ring.PrepareTimeout( BackOff, Tag( AcceptBackOffCompletion, ListenSocket ) );
+                    default :
+                        std::println( "[ Error {} ] {}\n Listen socket unusable, stop accepting", -CQE.res, strerrordesc_np( -CQE.res ) );
+                        return;
+                }
+                if( ! ( CQE.flags & IORING_CQE_F_MORE ) && ! Draining ) Ring.PrepareMultishotAccept( ListenSocket, Tag( AcceptCompletion, ListenSocket ) );
+            };
+
+            // replies the socket did not take at once, see Connection::Reply
+            auto PollWritable = [&]( Connection& Upstream ) {
+                if( Upstream.WatchingWritable || ! Upstream.HasQueued() ) return;
+                Upstream.WatchingWritable = true;
+                Ring.PreparePoll( Upstream.FD, POLLOUT, Tag( WritableCompletion, Upstream.FD ) );
+            };
+
+            auto OnWritable = [&]( int FD ) {
+                auto Found = Connections.find( FD );
+                if( Found == Connections.end() ) return;
+                auto& Upstream = *Found->second;
+                Upstream.WatchingWritable = false;
+                if( Upstream.SendQueued() == 0 ) return PollWritable( Upstream );
+                ::shutdown( FD, SHUT_RDWR );  // ends the receive, connection released there
+            };
+
+            auto OnReceive = [&]( const io_uring_cqe& CQE, int FD ) {
+                auto Found = Connections.find( FD );
+                if( Found == Connections.end() ) return;
+                auto& ConnectionPtr = Found->second;
+                if( CQE.flags & IORING_CQE_F_BUFFER )
+                {
+                    auto BufferId = static_cast<std::uint16_t>( CQE.flags >> IORING_CQE_BUFFER_SHIFT );
+                    if( CQE.res > 0 ) ConnectionPtr->ReadBuffer.append( Ring.BufferData( BufferId ), CQE.res );
+                    Ring.RecycleBuffer( BufferId );
+                }
+
+                auto KeepReading = CQE.res > 0 ? ProcessRecords( ConnectionPtr ) : CQE.res == -ENOBUFS;
+                if( KeepReading ) PollWritable( *ConnectionPtr );
+                if( CQE.flags & IORING_CQE_F_MORE )
+                {
+                    // receive still armed, end it by EOF before releasing the socket
+                    if( ! KeepReading ) ::shutdown( FD, SHUT_RD );
+                    return;
+                }
+                if( KeepReading ) return Ring.PrepareMultishotReceive( FD, Tag( ReceiveCompletion, FD ) );
+                if( ConnectionPtr->WatchingWritable ) Ring.PrepareCancel( Tag( WritableCompletion, FD ), Tag( CancelCompletion, FD ) );
+                ConnectionPtr->Cancel();
+                Connections.erase( Found );  // socket closed once the in-flight requests, if any, release it
+            };
+
+            while( ! StopToken.stop_requested() )
+            {
+                if( TerminationRequested() && ! std::exchange( Draining, true ) )
+                {
+                    Ring.PrepareCancel( Tag( AcceptCompletion, ListenSocket ), Tag( CancelCompletion, ListenSocket ) );
+                    auto Remaining = std::max( DrainDeadline() - std::chrono::steady_clock::now(), std::chrono::steady_clock::duration::zero() );
+                    auto Seconds = std::chrono::duration_cast<std::chrono::seconds>( Remaining );
+                    GracePeriod = { .tv_sec = Seconds.count(), .tv_nsec = std::chrono::nanoseconds{ Remaining - Seconds }.count() };
+                    Ring.PrepareTimeout( GracePeriod, Tag( GracePeriodCompletion, -1 ) );
+                    BeginDrain( Connections );
+                }
+
+                if( Ring.Submit( 1 ) == -1 )
+                {
+                    if( errno == EINTR ) continue;
+                    std::println( "[ Error {} ] {}\n FastCGI reactor stopped", errno, strerrordesc_np( errno ) );
+                    break;
+                }
+
+                Ring.ForEachCompletion( [&]( const io_uring_cqe& CQE ) {
+                    auto FD = static_cast<int>( CQE.user_data & 0xFFFF'FFFF );
+                    switch( static_cast<Completion>( CQE.user_data >> 32 ) )
+                    {
+                        case AcceptCompletion : return OnAccept( CQE );
+                        case ReceiveCompletion : return OnReceive( CQE, FD );
+                        case WritableCompletion : return OnWritable( FD );
+                        case CancelCompletion : return;
+                        case AcceptBackOffCompletion :
+                            AcceptPaused = false;
+                            if( ! Draining ) Ring.PrepareMultishotAccept( ListenSocket, Tag( AcceptCompletion, ListenSocket ) );
+                            return;
+                        case GracePeriodCompletion :
+                            for( auto& [ConnectionFD, ConnectionPtr] : Connections ) ConnectionPtr->Cancel();
+                            return;
+                        case WakeCompletion :
+                        {
+                            auto Discard = eventfd_t{};
+                            ::eventfd_read( WakeFD, &Discard );
+                            if( ! ( CQE.flags & IORING_CQE_F_MORE ) ) Ring.PrepareMultishotPoll( WakeFD, Tag( WakeCompletion, WakeFD ) );
+                            return;
+                        }
+                        case DeadlineCompletion :
+                            ExpireDeadlines();
+                            if( ! ( CQE.flags & IORING_CQE_F_MORE ) ) Ring.PrepareMultishotPoll( TimerFD, Tag( DeadlineCompletion, TimerFD ) );
+                            return;
+                    }
+                } );
+            }
+        }
+
+        // stop accepting, idle keep-alive connections closed so upstream reconnects elsewhere
+        // busy connections closed after their last request, see RequestContext::Finish
+        auto Engine::BeginDrain( ConnectionMap& Connections ) -> void
+        {
+            for( auto& [FD, ConnectionPtr] : Connections )
+                if( ConnectionPtr->ActiveRequests == 0 ) ::shutdown( FD, SHUT_RDWR );
+            std::println( "[ OK ]  Draining : stop accepting, {} requests in flight", InFlightCount.load() );
+            std::fflush( stdout );
+        }
+
+        auto Engine::AcceptConnections( ConnectionMap& Connections ) -> bool
+        {
+            while( true )
+            {
+                auto FD = ::accept4( ListenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC );
+                if( FD != -1 && ! WebServerAllowed( FD ) )
+                {
+                    ::close( FD );
+                    continue;
+                }
+                if( FD != -1 )
+                {
+                    Connections.insert_or_assign( FD, std::make_shared<Connection>( FD ) );
+                    Watch( FD, EPOLLIN | EPOLLRDHUP );
+                    continue;
+                }
+
+                switch( errno )
+                {
+                    case EINTR :
+                    case ECONNABORTED : continue;
+                    case EAGAIN :      return true;
+                    case EMFILE :
+                    case ENFILE :
+                    case ENOBUFS :
+                    case ENOMEM :
+                        // level-triggered listener would report the pending connection again at once
+                        std::println( "[ Error {} ] {}\n Fail to accept connection, pause accepting for {}", errno, strerrordesc_np( errno ), AcceptBackOff );
+                        ::epoll_ctl( EpollFD, EPOLL_CTL_DEL, ListenSocket, nullptr );
+                        return false;
+                    default :
+                        std::println( "[ Error {} ] {}\n Listen socket unusable, stop accepting", errno, strerrordesc_np( errno ) );
+                        ::epoll_ctl( EpollFD, EPOLL_CTL_DEL, ListenSocket, nullptr );
+                        return true;
+                }
+            }
+        }
+
+        // Return: [ false ] if connection should be closed
+        auto Engine::ReadRecords( const std::shared_ptr<Connection>& ConnectionPtr ) -> bool
+        {
+            auto& Buffer = ConnectionPtr->ReadBuffer;
+            for( auto Round = 0; Round < ReadRoundLimit; ++Round )
+            {
+                auto OldLength = Buffer.length();
+                auto ReceivedLength = ssize_t{};
+                auto ReceiveError = 0;
+                Buffer.resize_and_overwrite( OldLength + ReadChunkSize, [&]( char* Data, std::size_t ) {
+                    ReceivedLength = ::recv( ConnectionPtr->FD, Data + OldLength, ReadChunkSize, 0 );
+                    if( ReceivedLength < 0 ) ReceiveError = errno;
+                    return OldLength + static_cast<std::size_t>( std::max( ReceivedLength, ssize_t{ 0 } ) );
+                } );
+
+                if( ReceivedLength == 0 ) return false;  // closed by upstream
+                if( ReceivedLength < 0 )
+                {
+                    if( ReceiveError == EINTR ) continue;
+                    return ReceiveError == EAGAIN || ReceiveError == EWOULDBLOCK;
+                }
+                if( ! ProcessRecords( ConnectionPtr ) ) return false;
+            }
+            return true;  // level triggered, remaining data picked up in next round
+        }
+
+        auto Engine::ProcessRecords( const std::shared_ptr<Connection>& ConnectionPtr ) -> bool
+        {
+            auto& Buffer = ConnectionPtr->ReadBuffer;
+            auto Remaining = StrView{ Buffer };
+            while( Remaining.length() >= HeaderLength )
+            {
+                auto Header = RecordHeader::Decode( Remaining.data() );
+                if( Header.Version != ProtocolVersion ) return false;
+                if( Remaining.length() < Header.RecordLength() ) break;
+                if( ! HandleRecord( ConnectionPtr, Header, Remaining.substr( HeaderLength, Header.ContentLength ) ) ) return false;
+                Remaining.remove_prefix( Header.RecordLength() );
+            }
+            Buffer.erase( 0, Buffer.length() - Remaining.length() );
+            return true;
+        }
+
+        // Return: [ false ] on protocol violation
+        auto Engine::HandleRecord( const std::shared_ptr<Connection>& ConnectionPtr, RecordHeader Header, StrView Content ) -> bool
+        {
+            if( Header.RequestId == NullRequestId )
+            {
+                HandleManagementRecord( *ConnectionPtr, Header, Content );
+                return true;
+            }
+
+            auto& Pending = ConnectionPtr->Pending;
+            auto Found = Pending.find( Header.RequestId );
+            auto IsPending = Found != Pending.end();
+            switch( Header.Type )
+            {
+                case RecordType::BeginRequest :
+                {
+                    if( Content.length() < 8 ) return false;
+                    if( IsPending ) return true;  // duplicated requestId, ignored as the spec says
+                    auto RequestRole = static_cast<Role>( static_cast<unsigned char>( Content[0] ) << 8 | static_cast<unsigned char>( Content[1] ) );
+                    auto Flags = static_cast<std::uint8_t>( Content[2] );
+
+                    auto Reply = std::string{};
+                    if( ConnectionPtr->ActiveRequests > 0 && ! Config::MultiplexConnections )
+                        AppendEndRequest( Reply, Header.RequestId, 0, ProtocolStatus::CantMultiplexConnection );
+                    else if( RequestRole != Role::Responder )
+                        AppendEndRequest( Reply, Header.RequestId, 0, ProtocolStatus::UnknownRole );
+                    if( ! Reply.empty() ) return ConnectionPtr->Reply( Reply );
+
+                    auto Context = std::make_unique<RequestContext>();
+                    Context->RequestId = Header.RequestId;
+                    Context->KeepConnection = Flags & KeepConnectionFlag;
+                    Pending.emplace( Header.RequestId, Connection::PendingRequest{ std::move( Context ) } );
+                    ++ConnectionPtr->ActiveRequests;
+                    ++InFlightCount;
+                    return true;
+                }
+                case RecordType::Params :
+                {
+                    if( ! IsPending ) return true;  // stale record of rejected / aborted request
+                    auto& [Context, EncodedParams] = Found->second;
+                    if( ! Content.empty() )
+                    {
+                        EncodedParams += Content;
+                        return true;
+                    }
+                    if( ! BuildEnvironment( *Context, std::exchange( EncodedParams, {} ) ) ) return false;
+                    if( auto Status = CheckParams( *Context ); Status != HTTP::StatusCode::OK ) return Reject( ConnectionPtr, Header.RequestId, Status );
+
+                    auto ContentTypeField = ParamOf( *Context, "CONTENT_TYPE" );
+                    auto Boundary = MultiPart::BoundaryOf( ContentTypeField );
+                    if( ! Config::UploadSpoolPath.empty() &&  //
+                        HTTP::ContentType::FromStringView( ContentTypeField ) == HTTP::ContentType::EnumValue::MULTIPART_FORM_DATA &&  //
+                        ! Boundary.empty() && Boundary.length() <= MultiPart::BoundaryLengthLimit )
+                        Context->Spool = std::make_unique<UploadSpool>( Boundary, Context->Limits );
+                    else if( Context->Limits.MaxBodySize > 0 )  // within limit, body allocated once
+                        Context->StdIn.reserve( ParamOf( *Context, "CONTENT_LENGTH" ) | ConvertTo<std::size_t> | ParseUtil::FallBack( 0uz ) );
+                    return true;
+                }
+                case RecordType::StdIn :
+                {
+                    if( ! IsPending ) return true;
+                    auto& Context = *Found->second.Context;
+                    if( Content.empty() )
+                    {
+                        if( auto Status = CheckBody( Context ); Status != HTTP::StatusCode::OK ) return Reject( ConnectionPtr, Header.RequestId, Status );
+                        DispatchPending( ConnectionPtr, std::move( Pending.extract( Found ).mapped().Context ) );
+                        return true;
+                    }
+
+                    // CONTENT_LENGTH may be absent or wrong, counted as received
+                    Context.BodyLength += Content.length();
+                    if( Context.Limits.MaxBodySize > 0 && Context.BodyLength > Context.Limits.MaxBodySize )
+                        return Reject( ConnectionPtr, Header.RequestId, HTTP::StatusCode::PayloadTooLarge );
+                    if( Context.Spool == nullptr )
+                    {
+                        Context.StdIn += Content;
+                        return true;
+                    }
+                    Context.Spool->Feed( Content );
+                    if( Context.Spool->Overflow ) return Reject( ConnectionPtr, Header.RequestId, HTTP::StatusCode::BadRequest );
+                    if( Context.Spool->FieldTooLarge ) return Reject( ConnectionPtr, Header.RequestId, HTTP::StatusCode::PayloadTooLarge );
+                    return true;
+                }
+                case RecordType::AbortRequest :
+                {
+                    if( ! IsPending )
+                    {
+                        // in-flight handler observes its StopToken, END_REQUEST sent once it returns
+                        ConnectionPtr->Cancel( Header.RequestId );
+                        return true;
+                    }
+                    auto Reply = std::string{};
+                    AppendEndRequest( Reply, Header.RequestId, 0, ProtocolStatus::RequestComplete );
+                    return RespondPending( ConnectionPtr, Header.RequestId, Reply );
+                }
+                default : return true;  // DATA is for filter role only
+            }
+        }
+
+        // respond without dispatching, records of the request still on the way dropped as stale
+        auto Engine::Reject( const std::shared_ptr<Connection>& ConnectionPtr, std::uint16_t RequestId, HTTP::StatusCode Status ) -> bool
+        {
+            auto Message = Status == HTTP::StatusCode::PayloadTooLarge ? "Payload Too Large."sv : "Bad Request."sv;
+            auto Reply = std::string{};
+            AppendRecord( Reply, RecordType::StdOut, RequestId, "Status: {}\r\nContent-Type: text/html; charset=UTF-8\r\n\r\n{}"_FMT( std::to_underlying( Status ), Message ) );
+            AppendRecord( Reply, RecordType::StdOut, RequestId, {} );
+            AppendEndRequest( Reply, RequestId, 0, ProtocolStatus::RequestComplete );
+            return RespondPending( ConnectionPtr, RequestId, Reply );
+        }
+
+        // pending request ends without reaching a worker, connection then closed as RequestContext::Finish would
+        auto Engine::RespondPending( const std::shared_ptr<Connection>& ConnectionPtr, std::uint16_t RequestId, StrView Reply ) -> bool
+        {
+            auto KeepConnection = false;
+            if( auto Found = ConnectionPtr->Pending.find( RequestId ); Found != ConnectionPtr->Pending.end() )
+            {
+                KeepConnection = Found->second.Context->KeepConnection;
+                ConnectionPtr->Pending.erase( Found );
+            }
+            auto LastActiveRequest = --ConnectionPtr->ActiveRequests == 0;
+            RetireRequests( 1 );
+
+            if( ! ConnectionPtr->Reply( Reply ) ) return false;
+            if( LastActiveRequest && ( ! KeepConnection || TerminationRequested() ) ) ConnectionPtr->ShutdownWhenSent();
+            return true;
+        }
+
+        auto Engine::HandleManagementRecord( Connection& Upstream, RecordHeader Header, StrView Content ) -> void
+        {
+            auto Reply = std::string{};
+            if( Header.Type == RecordType::GetValues )
+            {
+                auto Values = std::string{};
+                DecodeParams( Content, [&Values]( StrView Name, StrView ) {
+                    if( Name == "FCGI_MAX_CONNS" || Name == "FCGI_MAX_REQS" ) AppendParam( Values, Name, MaxConnectionsValue );
+                    if( Name == "FCGI_MPXS_CONNS" ) AppendParam( Values, Name, Config::MultiplexConnections ? "1" : "0" );
+                } );
+                AppendRecord( Reply, RecordType::GetValuesResult, NullRequestId, Values );
+            }
+            else
+            {
+                char Body[8] = { static_cast<char>( Header.Type ) };
+                AppendRecord( Reply, RecordType::UnknownType, NullRequestId, { Body, sizeof( Body ) } );
+            }
+            std::ignore = Upstream.Reply( Reply );
+        }
+
+        auto Engine::DispatchPending( const std::shared_ptr<Connection>& ConnectionPtr, std::unique_ptr<RequestContext> Context ) -> void
+        {
+            Context->ListenSocket = ListenSocket;
+            Context->Owner = this;
+            Context->ConnectionPtr = ConnectionPtr;
+            Context->ReadyTime = std::chrono::steady_clock::now();
+            {
+                auto Lock = std::lock_guard{ ConnectionPtr->InFlightMutex };
+                ConnectionPtr->InFlight.insert_or_assign( Context->RequestId, Context->Cancellation );
+            }
+            {
+                auto Lock = std::lock_guard{ ReadyMutex };
+                ReadyQueue.push_back( std::move( Context ) );
+            }
+            ReadyCV.notify_one();
+        }
+
+        // close the trailing STDOUT record, an empty one would signal end of stream so it is dropped instead
+        static auto SealStdOut( RequestContext& Context ) -> void
+        {
+            if( Context.OpenRecordOffset == std::string::npos ) return;
+            auto Offset = std::exchange( Context.OpenRecordOffset, std::string::npos );
+            auto ContentLength = Context.OutBuffer.length() - Offset - HeaderLength;
+            if( ContentLength == 0 ) return Context.OutBuffer.resize( Offset );
+
+            auto Header = RecordHeader{ .Version = ProtocolVersion,
+                                        .Type = RecordType::StdOut,
+                                        .RequestId = Context.RequestId,
+                                        .ContentLength = static_cast<std::uint16_t>( ContentLength ),
+                                        .PaddingLength = static_cast<std::uint8_t>( ( 8 - ContentLength % 8 ) % 8 ) };
+            Header.Encode( Context.OutBuffer.data() + Offset );
+            Context.OutBuffer.append( Header.PaddingLength, '\0' );
+        }
+
+        // frame content in place as STDOUT records, no extra copy on flush
+        auto RequestContext::Put( StrView Content ) -> int
+        {
+            if( ConnectionPtr == nullptr || Error != 0 ) return -1;
+            while( ! Content.empty() )
+            {
+                if( OpenRecordOffset == std::string::npos )
+                {
+                    OpenRecordOffset = OutBuffer.length();
+                    OutBuffer.append( HeaderLength, '\0' );
+                }
+                auto Room = MaxContentLength - ( OutBuffer.length() - OpenRecordOffset - HeaderLength );
+                auto Chunk = Content.substr( 0, Room );
+                OutBuffer += Chunk;
+                Content.remove_prefix( Chunk.length() );
+                if( Chunk.length() == Room ) SealStdOut( *this );
+            }
+            if( OutBuffer.length() >= OutputFlushThreshold ) return Flush();
+            return 0;
+        }
+
+        auto RequestContext::Flush() -> int
+        {
+            SealStdOut( *this );
+            if( ConnectionPtr == nullptr || Error != 0 )
+            {
+                OutBuffer.clear();
+                return -1;
+            }
+            if( OutBuffer.empty() ) return 0;
+            Error = ConnectionPtr->Write( OutBuffer );
+            OutBuffer.clear();
+            return Error == 0 ? 0 : -1;
+        }
+
+        static auto AdmittedRequests = std::atomic<std::size_t>{ 0 };
+
+        auto RequestContext::Admit() -> bool
+        {
+            if( Config::MaxQueueDelay > 0ms && std::chrono::steady_clock::now() - ReadyTime > Config::MaxQueueDelay ) return false;
+            if( Config::MaxInFlightRequests == 0 ) return true;
+            if( AdmittedRequests.fetch_add( 1, std::memory_order_relaxed ) >= Config::MaxInFlightRequests )
+            {
+                AdmittedRequests.fetch_sub( 1, std::memory_order_relaxed );
+                return false;
+            }
+            return Admitted = true;
+        }
+
+        auto RequestContext::Finish( std::uint32_t AppStatus ) -> void
+        {
+            if( std::exchange( Admitted, false ) ) AdmittedRequests.fetch_sub( 1, std::memory_order_relaxed );
+            ClearDeadline();
+            if( ConnectionPtr == nullptr || std::exchange( Finished, true ) ) return;
+            SealStdOut( *this );
+            AppendRecord( OutBuffer, RecordType::StdOut, RequestId, {} );
+            AppendEndRequest( OutBuffer, RequestId, AppStatus, ProtocolStatus::RequestComplete );
+
+            {
+                auto Lock = std::lock_guard{ ConnectionPtr->InFlightMutex };
+                ConnectionPtr->InFlight.erase( RequestId );
+            }
+            // upstream may send next BEGIN_REQUEST as soon as it sees END_REQUEST
+            auto LastActiveRequest = --ConnectionPtr->ActiveRequests == 0;
+            Flush();
+            RetireRequests( 1 );
+
+            // fastcgi_keep_conn on : connection stays with the reactor for the next request
+            // fastcgi_keep_conn off : application is responsible for closing, reactor releases it on EOF
+            // multiplexed requests sharing the connection are not cut short
+            // draining : no keep-alive, upstream reconnects elsewhere
+            auto CloseConnection = LastActiveRequest && ( ! KeepConnection || TerminationRequested() );
+            if( CloseConnection || Error != 0 ) ::shutdown( ConnectionPtr->FD, SHUT_RDWR );
+            ConnectionPtr.reset();
+        }
+
+        RequestContext::~RequestContext() { Finish(); }
+    }  // namespace FastCGI
+
+    auto InFlightRequests() -> std::size_t { return FastCGI::InFlightCount; }
+
+    namespace Async
+    {
+        // timers and upstream writability of suspended handlers, ready coroutines resumed by worker threads
+        struct EventLoop
+        {
+            using TimePoint = std::chrono::steady_clock::time_point;
+
+            int EpollFD;
+            int WakeFD;
+            std::mutex Mutex{};
+            std::condition_variable ReadyCV{};
+            std::deque<std::coroutine_handle<>> ReadyQueue{};
+            std::multimap<TimePoint, std::coroutine_handle<>> Timers{};
+            std::unordered_map<int, std::vector<std::coroutine_handle<>>> WritableWaiters{};
+            std::size_t LiveTasks{};
+            std::jthread Loop{};
+
+            EventLoop();
+            ~EventLoop();
+
+            static auto Instance() -> EventLoop&;  // per process, started on first use after fork
+
+            auto Spawn( std::coroutine_handle<> ) -> void;
+            auto Retain() -> void;  // keep workers alive without a task, paired with Retire
+            auto Retire() -> void;
+            auto Post( std::coroutine_handle<> ) -> void;
+
+            // block until a coroutine is ready to resume
+            // Return: [ nullptr ] if TerminationToken activated and all spawned tasks retired
+            auto NextReady() -> std::coroutine_handle<>;
+
+            auto AddTimer( TimePoint, std::coroutine_handle<> ) -> void;
+            auto RemoveTimer( TimePoint, std::coroutine_handle<> ) -> bool;
+            auto AddWritableWaiter( int FD, std::coroutine_handle<> ) -> void;
+            auto Wake() -> void { ::eventfd_write( WakeFD, 1 ); }  // async-signal-safe
+            auto LoopUntil( std::stop_token ) -> void;
+        };
+
+        // top level frame owning the Request, destroyed on completion
+        struct DetachedTask
         {
-            auto [Encoded, Unencoded] = Segment | SplitAt( EncodeDigitWidth );
-            Result += Encoded.length() >= EncodeDigitWidth ? HexToChar( Encoded ) : '?';
-            Result += Unencoded | RestoreSpaceChar;
+            struct promise_type
+            {
+                auto get_return_object() -> DetachedTask { return { std::coroutine_handle<promise_type>::from_promise( *this ) }; }
+                auto initial_suspend() noexcept -> std::suspend_always { return {}; }
+                auto final_suspend() noexcept -> std::suspend_never { return {}; }
+                auto return_void() -> void {}
+                auto unhandled_exception() -> void { std::terminate(); }
+            };
+
+            std::coroutine_handle<promise_type> Handle;
+        };
+
+        EventLoop::EventLoop()
+            : EpollFD{ ::epoll_create1( EPOLL_CLOEXEC ) },
+              WakeFD{ ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) }
+        {
+            if( EpollFD == -1 || WakeFD == -1 )
+            {
+                std::println( "[ Fatal ] [ Error {} ] {}\n Fail to set up coroutine event loop", errno, strerrordesc_np( errno ) );
+                std::exit( errno );
+            }
+            auto Event = epoll_event{ .events = EPOLLIN, .data = { .fd = WakeFD } };
+            ::epoll_ctl( EpollFD, EPOLL_CTL_ADD, WakeFD, &Event );
+            Loop = std::jthread{ [this]( std::stop_token StopToken ) { LoopUntil( StopToken ); } };
         }
-        return Result;
-    }
-}  // namespace ParseUtil
 
-namespace EasyFCGI
-{
-    using ParseUtil::operator""_FMT;
+        EventLoop::~EventLoop()
+        {
+            Loop.request_stop();
+            if( Loop.joinable() ) Loop.join();
+            ::close( EpollFD );
+            ::close( WakeFD );
+        }
 
-    namespace Config
-    {
-        int DefaultBackLogNumber = int{ 128 };  // evetually be capped by /proc/sys/net/core/somaxconncat,ie.4096
+        auto EventLoop::Instance() -> EventLoop&
+        {
+            static auto Instance = EventLoop{};
+            return Instance;
+        }
 
-        auto CommandLine()
+        auto EventLoop::Spawn( std::coroutine_handle<> Handle ) -> void
         {
-            static auto CommandLineBuffer = ReadContent( "/proc/self/cmdline" );
-            static auto CommandLine = CommandLineBuffer                         //
-                                      | VIEW::take( CommandLineBuffer.size() )  // keep trailing '\0'
-                                      | VIEW::split( '\0' )                     // will result in ending empty element
-                                      | VIEW::transform( RNG::data )            // reduce back to char*
-                                      | RNG::to<std::vector>();
-            CommandLine.back() = &CommandLineBuffer.back();  // end argv with "\0"
-            return CommandLine;
+            {
+                auto Lock = std::lock_guard{ Mutex };
+                ++LiveTasks;
+                ReadyQueue.push_back( Handle );
+            }
+            ReadyCV.notify_one();
         }
 
-        bool RunAsDaemon = LaunchOptionContains( "d" );
-        auto ScriptName = FS::path( CommandLine()[0] ).filename().replace_extension( {} ).string();
+        auto EventLoop::Retain() -> void
+        {
+            auto Lock = std::lock_guard{ Mutex };
+            ++LiveTasks;
+        }
 
-        FS::path CWD{};
-        FS::path LogFilePath{};
-        FS::path PidFilePath{};
-        FS::path SokcetPath{};
+        auto EventLoop::Retire() -> void
+        {
+            auto Lock = std::lock_guard{ Mutex };
+            if( --LiveTasks == 0 && TerminationRequested() ) ReadyCV.notify_all();
+        }
 
-        auto LaunchOptionContains( StrView TargetOption ) -> bool
+        auto EventLoop::Post( std::coroutine_handle<> Handle ) -> void
         {
-            for( StrView Option : CommandLine() )
             {
-                if( Option.starts_with( "--" ) )
-                {
-                    Option.remove_prefix( 2 );
-                    if( Option == TargetOption ) return true;
-                }
-                else if( Option.starts_with( '-' ) )
+                auto Lock = std::lock_guard{ Mutex };
+                ReadyQueue.push_back( Handle );
+            }
+            ReadyCV.notify_one();
+        }
+
+        auto EventLoop::NextReady() -> std::coroutine_handle<>
+        {
+            auto Lock = std::unique_lock{ Mutex };
+            ReadyCV.wait( Lock, [this] { return ! ReadyQueue.empty() || ( TerminationRequested() && LiveTasks == 0 ); } );
+            if( ReadyQueue.empty() ) return nullptr;
+            auto Next = ReadyQueue.front();
+            ReadyQueue.pop_front();
+            return Next;
+        }
+
+        auto EventLoop::AddTimer( TimePoint Deadline, std::coroutine_handle<> Handle ) -> void
+        {
+            auto Lock = std::lock_guard{ Mutex };
+            auto Position = Timers.emplace( Deadline, Handle );
+            if( Position == Timers.begin() ) Wake();  // loop is waiting on a later deadline
+        }
+
+        // Return: [ true ] if Handle was still waiting, caller takes over resuming it
+        auto EventLoop::RemoveTimer( TimePoint Deadline, std::coroutine_handle<> Handle ) -> bool
+        {
+            auto Lock = std::lock_guard{ Mutex };
+            for( auto [Current, End] = Timers.equal_range( Deadline ); Current != End; ++Current )
+                if( Current->second == Handle )
                 {
-                    Option.remove_prefix( 1 );
-                    if( Option.contains( TargetOption ) ) return true;
+                    Timers.erase( Current );
+                    return true;
                 }
-            }
             return false;
         }
 
-        auto LaunchOptionValue( StrView TargetOption ) -> std::optional<StrView>
+        auto EventLoop::AddWritableWaiter( int FD, std::coroutine_handle<> Handle ) -> void
         {
-            for( auto&& [OptionKey, OptionValue] : CommandLine() | VIEW::pairwise )
+            auto Lock = std::lock_guard{ Mutex };
+            auto& Waiters = WritableWaiters[FD];
+            Waiters.push_back( Handle );
+            if( Waiters.size() > 1 ) return;  // multiplexed requests share the registration
+
+            auto Event = epoll_event{ .events = EPOLLOUT | EPOLLONESHOT, .data = { .fd = FD } };
+            if( ::epoll_ctl( EpollFD, EPOLL_CTL_ADD, FD, &Event ) == 0 ) return;
+            std::println( "[ Error {} ] {}\n Fail to watch file descriptor {}", errno, strerrordesc_np( errno ), FD );
+            for( auto Waiter : std::exchange( Waiters, {} ) ) ReadyQueue.push_back( Waiter );  // resume anyway, flush reports failure
+            WritableWaiters.erase( FD );
+            ReadyCV.notify_all();
+        }
+
+        auto EventLoop::LoopUntil( std::stop_token StopToken ) -> void
+        {
+            auto WakeOnStop = std::stop_callback{ StopToken, [this] { Wake(); } };
+            auto WakeOnTermination = std::stop_callback{ TerminationToken, [this] { Wake(); } };
+            auto Events = std::array<epoll_event, 64>{};
+
+            while( ! StopToken.stop_requested() )
             {
-                auto Option = StrView( OptionKey );
-                if( Option.starts_with( "--" ) )
-                    Option.remove_prefix( 2 );
-                else if( Option.starts_with( '-' ) )
-                    Option.remove_prefix( 1 );
-                else
-                    continue;
-                if( ! Option.starts_with( TargetOption ) ) continue;
+                auto Timeout = -1;
+                {
+                    auto Lock = std::lock_guard{ Mutex };
+                    auto NextExpiry = TimePoint::max();
+                    if( ! Timers.empty() ) NextExpiry = Timers.begin()->first;
+                    if( NextExpiry != TimePoint::max() )
+                    {
+                        auto Remaining = std::chrono::ceil<std::chrono::milliseconds>( NextExpiry - std::chrono::steady_clock::now() );
+                        Timeout = static_cast<int>( std::clamp<std::chrono::milliseconds::rep>( Remaining.count(), 0, std::numeric_limits<int>::max() ) );
+                    }
+                }
 
-                Option.remove_prefix( TargetOption.length() );
-                if( Option.empty() )
+                auto EventCount = ::epoll_wait( EpollFD, Events.data(), Events.size(), Timeout );
+                if( EventCount == -1 && errno != EINTR )
                 {
-                    if( OptionValue[0] == '-' ) return std::nullopt;
-                    return OptionValue;
+                    std::println( "[ Error {} ] {}\n Coroutine event loop stopped", errno, strerrordesc_np( errno ) );
+                    break;
                 }
-                else if( Option[0] == '=' )
+
+                auto Lock = std::unique_lock{ Mutex };
+                auto ReadyCount = ReadyQueue.size();
+                for( const auto& Event : Events | VIEW::take( std::max( EventCount, 0 ) ) )
                 {
-                    Option.remove_prefix( 1 );
-                    if( Option.empty() ) return std::nullopt;
-                    return Option;
+                    auto FD = Event.data.fd;
+                    if( FD == WakeFD )
+                    {
+                        auto Discard = eventfd_t{};
+                        ::eventfd_read( WakeFD, &Discard );
+                        continue;
+                    }
+                    ::epoll_ctl( EpollFD, EPOLL_CTL_DEL, FD, nullptr );
+                    if( auto Found = WritableWaiters.find( FD ); Found != WritableWaiters.end() )
+                    {
+                        RNG::copy( Found->second, std::back_inserter( ReadyQueue ) );
+                        WritableWaiters.erase( Found );
+                    }
+                }
+
+                // termination resumes every waiter, SleepFor reports false and handlers wind down
+                auto Expired = TerminationRequested() ? Timers.end() : Timers.upper_bound( std::chrono::steady_clock::now() );
+                for( auto Timer : RNG::subrange( Timers.begin(), Expired ) ) ReadyQueue.push_back( Timer.second );
+                Timers.erase( Timers.begin(), Expired );
+                if( TerminationRequested() )
+                {
+                    for( auto& [FD, Waiters] : WritableWaiters )
+                    {
+                        ::epoll_ctl( EpollFD, EPOLL_CTL_DEL, FD, nullptr );
+                        RNG::copy( Waiters, std::back_inserter( ReadyQueue ) );
+                    }
+                    WritableWaiters.clear();
                 }
+
+                if( ReadyQueue.size() != ReadyCount || TerminationRequested() ) ReadyCV.notify_all();
             }
-            return std::nullopt;
         }
 
-    }  // namespace Config
+        auto SleepAwaiter::await_suspend( std::coroutine_handle<> Handle ) -> bool
+        {
+            auto& Loop = EventLoop::Instance();
+            auto Deadline = std::chrono::steady_clock::now() + Duration;
+            auto Token = StopToken;  // awaiter may be gone once timer registered
+            // stop may race with expiry or precede registration, whoever removes the timer resumes the coroutine
+            if( Token.stop_possible() )
+                ResumeOnStop.emplace( Token, [&Loop, Deadline, Handle] {
+                    if( Loop.RemoveTimer( Deadline, Handle ) ) Loop.Post( Handle );
+                } );
+            Loop.AddTimer( Deadline, Handle );
+            return ! ( Token.stop_requested() && Loop.RemoveTimer( Deadline, Handle ) );
+        }
 
-    auto DumpJson( const EasyFCGI::Json& J ) -> std::string
-    {
-        if( auto TryDump = J.dump() )
+        // suspended until FD is writable
+        struct WritableAwaiter
         {
-            return std::move( TryDump.value() );
+            int FD;
+            auto await_ready() const noexcept -> bool { return false; }
+            auto await_suspend( std::coroutine_handle<> Handle ) const -> void { EventLoop::Instance().AddWritableWaiter( FD, Handle ); }
+            auto await_resume() const noexcept -> void {}
+        };
+
+        // sends as upstream drains the connection, then hands the flushing handler back to the worker pool
+        static auto DrainOutput( FastCGI::RequestContext& Context, std::uint64_t Position, int& Result, std::coroutine_handle<> Flusher ) -> DetachedTask
+        {
+            auto Upstream = Context.ConnectionPtr;
+            auto Error = 0;
+            while( ( Error = Upstream->SendQueued( Position ) ) == EAGAIN && ! TerminationRequested() ) co_await WritableAwaiter{ Upstream->FD };
+            if( Error == EAGAIN ) Error = Upstream->Write( {} );  // draining, writable waiters no longer parked
+            Context.Error = Error;
+            Result = Error == 0 ? 0 : -1;
+            EventLoop::Instance().Post( Flusher );
         }
-        else
+
+        auto FlushAwaiter::await_ready() const -> bool
         {
-            return std::format( R"({{"DumpError":"{}"}})", TryDump.error().custom_error_message );
+            const auto& Context = Target.FCGI_Request_Ptr;
+            if( Context == nullptr || Context->ConnectionPtr == nullptr || Context->Error != 0 || Context->Cancellation.stop_requested() )
+            {
+                Result = Target.Flush();
+                return true;
+            }
+            FastCGI::SealStdOut( *Context );
+            Position = Context->ConnectionPtr->Enqueue( Context->OutBuffer );
+            Context->OutBuffer.clear();
+            if( auto Error = Context->ConnectionPtr->SendQueued( Position ); Error != EAGAIN )
+            {
+                Context->Error = Error;
+                Result = Error == 0 ? 0 : -1;
+                return true;
+            }
+            return false;
         }
-    }
 
-    auto TerminationSource = std::stop_source{};
-    std::stop_token TerminationToken = TerminationSource.get_token();
-    auto TerminationRequested() -> bool { return TerminationToken.stop_requested(); }
+        // frame of the awaiting coroutine untouched once DrainOutput is started, it may resume elsewhere right away
+        auto FlushAwaiter::await_suspend( std::coroutine_handle<> Handle ) const -> void
+        {
+            DrainOutput( *Target.FCGI_Request_Ptr, Position, Result, Handle ).Handle.resume();
+        }
 
-    auto SleepFor( Clock::duration SleepDuartion ) -> bool
+        auto FlushAwaiter::await_resume() const -> int { return Result; }
+
+        auto SleepFor( Clock::duration Duration, std::stop_token StopToken ) -> SleepAwaiter { return { Duration, std::move( StopToken ) }; }
+    }  // namespace Async
+
+    auto FastCGI::RequestContext::SetDeadline( std::chrono::steady_clock::time_point NewDeadline ) -> void
     {
-        auto CVA = std::condition_variable_any{};
-        auto DummyMutex = std::mutex{};
-        auto DummyLock = std::unique_lock{ DummyMutex };
-        CVA.wait_for( DummyLock, TerminationToken, SleepDuartion, TerminationRequested );
-        return ! TerminationRequested();
+        if( NewDeadline >= Deadline || Owner == nullptr ) return;
+        ClearDeadline();
+        Deadline = NewDeadline;
+        Owner->AddDeadline( Deadline, Cancellation );
+    }
+
+    auto FastCGI::RequestContext::ClearDeadline() -> void
+    {
+        if( Deadline == std::chrono::steady_clock::time_point::max() ) return;
+        Owner->RemoveDeadline( Deadline, Cancellation );
+        Deadline = std::chrono::steady_clock::time_point::max();
     }
 
     Response& Response::Set( HTTP::StatusCode NewValue ) & { return StatusCode = NewValue, *this; }
@@ -204,65 +2384,332 @@ namespace EasyFCGI
         return *this;
     }
 
-    auto Request::Query::contains( StrView Key ) const -> bool { return Json.contains( Key ); }
-    auto Request::Query::CountRepeated( StrView Key ) const -> decltype( Json.size() )
+    auto Request::Query::clear() -> void
+    {
+        Buffer.clear();
+        Entries.clear();
+        Slots.clear();
+        JsonView.reset();
+        Source = nullptr;
+    }
+
+    auto Request::Query::Bind( FastCGI::RequestContext* Context ) -> void
+    {
+        clear();
+        Source = Context;
+    }
+
+    auto Request::Query::Materialize() const -> void
+    {
+        auto Context = std::exchange( Source, nullptr );
+        if( Context == nullptr ) return;
+        auto& Self = const_cast<Request::Query&>( *this );  // only mutable members touched
+        auto ContentTypeField = FastCGI::ParamOf( *Context, "CONTENT_TYPE" );
+        auto Payload = StrView{ Context->StdIn };
+
+        // read query string, then request body
+        // repeated keys keep all values in order
+        Self.AppendEncoded( FastCGI::ParamOf( *Context, "QUERY_STRING" ) );
+
+        switch( HTTP::ContentType{ ContentTypeField } )
+        {
+            default : break;
+            case HTTP::Content::Application::FormURLEncoded :
+            {
+                Self.AppendEncoded( Payload );
+                break;
+            }
+            case HTTP::Content::MultiPart::FormData :
+            {
+                if( Context->Spool != nullptr )
+                {
+                    for( auto& Part : Context->Spool->Parts ) Self.Append( Part.Name, Part.ContentType.empty() ? StrView{ Part.Content } : StrView{ Part.FileName } );
+                    break;
+                }
+                MultiPart::Scan( ContentTypeField, Payload, [&]( StrView Name, StrView FileName, StrView ContentType, StrView Content ) {
+                    Self.Append( Name, ContentType.empty() ? Content : FileName );
+                } );
+                break;
+            }
+            case HTTP::Content::Application::Json :
+            {
+                auto Body = EasyFCGI::Json{};
+                auto ParseResult = glz::read_json( Body, Context->StdIn );  // null terminated
+                if( ParseResult == glz::error_code::none )
+                {
+                    Self.AppendJson( std::move( Body ) );
+                    break;
+                }
+                // validated in Parse already, body adds no entries should the two ever disagree
+                std::println( "[ Warn ] Json body passed validation but failed to parse.\n{}", glz::format_error( ParseResult, Payload ) );
+                std::fflush( stdout );
+                break;
+            }
+        }
+    }
+
+    auto Request::Query::KeyOf( const Entry& E ) const -> StrView { return StrView{ Buffer }.substr( E.KeyOffset, E.KeyLength ); }
+    auto Request::Query::ValueOf( const Entry& E ) const -> StrView { return StrView{ Buffer }.substr( E.ValueOffset, E.ValueLength ); }
+
+    // open addressing over entry indices by ParseUtil::HashKey, Slots sized a power of 2 and never full
+    // Return: slot holding the entry keyed Key, or the free slot it belongs to
+    static auto ProbeSlot( const std::vector<std::uint32_t>& Slots, StrView Key, auto&& KeyOfEntry ) -> std::size_t
     {
-        if( ! Json.contains( Key ) ) return 0;
-        return Json[Key].size();
+        auto Mask = Slots.size() - 1;
+        auto Slot = ParseUtil::HashKey( Key ) & Mask;
+        while( Slots[Slot] != ~std::uint32_t{} && KeyOfEntry( Slots[Slot] ) != Key ) Slot = ( Slot + 1 ) & Mask;
+        return Slot;
     }
 
-    auto Request::Query::StringDump( const EasyFCGI::Json& Json ) -> std::string  //
+    auto Request::Query::Find( StrView Key ) const -> std::uint32_t
     {
-        return Json.is_string() ? Json.get_string() : DumpJson( Json );
+        Materialize();
+        if( Slots.empty() ) return NoEntry;
+        return Slots[ProbeSlot( Slots, Key, [this]( std::uint32_t Index ) { return KeyOf( Entries[Index] ); } )];
     }
-    auto Request::Query::GetOptional( StrView Key, std::size_t Index ) const -> std::optional<std::string>
+
+    // entry already in Entries and Buffer, link it to its key
+    static auto IndexEntry( Request::Query& Query, std::uint32_t EntryIndex ) -> void
     {
-        if( ! Json.contains( Key ) ) return std::nullopt;
-        const auto& Slot = Json[Key];
-        if( Slot.is_array() && Slot.size() > Index ) return StringDump( Slot[auto{ Index }] );
-        if( Index > 0 ) return std::nullopt;
-        return StringDump( Slot );
+        auto& Slots = Query.Slots;
+        auto KeyAt = [&Query]( std::uint32_t Index ) { return Query.KeyOf( Query.Entries[Index] ); };
+        if( ( Query.Entries.size() + 1 ) * 2 > Slots.size() )  // load factor below 1/2, rehash first entries of keys
+        {
+            Slots.assign( std::max( 16uz, std::bit_ceil( Query.Entries.size() * 4 ) ), Request::Query::NoEntry );
+            for( auto&& [Index, E] : Query.Entries | VIEW::enumerate | VIEW::take( EntryIndex ) )
+                if( E.Count > 0 ) Slots[ProbeSlot( Slots, Query.KeyOf( E ), KeyAt )] = static_cast<std::uint32_t>( Index );
+        }
+
+        auto& New = Query.Entries[EntryIndex];
+        auto Slot = ProbeSlot( Slots, Query.KeyOf( New ), KeyAt );
+        if( Slots[Slot] == Request::Query::NoEntry )
+        {
+            Slots[Slot] = EntryIndex;
+            New.LastSameKey = EntryIndex;
+            New.Count = 1;
+            return;
+        }
+        auto& First = Query.Entries[Slots[Slot]];
+        Query.Entries[First.LastSameKey].NextSameKey = EntryIndex;
+        First.LastSameKey = EntryIndex;
+        ++First.Count;
     }
-    auto Request::Query::operator[]( StrView Key, std::size_t Index ) const -> std::string  //
+
+    auto Request::Query::Append( StrView Key, StrView Value ) -> void
     {
-        return GetOptional( Key, Index ).value_or( std::string{} );
+        Materialize();  // appended after decoded entries
+        if( Key.empty() || Buffer.length() + Key.length() + Value.length() > NoEntry ) return;
+        auto KeyOffset = static_cast<std::uint32_t>( Buffer.length() );
+        Buffer.append( Key ).append( Value );
+        Entries.push_back( { KeyOffset, static_cast<std::uint32_t>( Key.length() ),                           //
+                             static_cast<std::uint32_t>( KeyOffset + Key.length() ), static_cast<std::uint32_t>( Value.length() ),  //
+                             NoEntry, NoEntry, 0 } );
+        IndexEntry( *this, static_cast<std::uint32_t>( Entries.size() - 1 ) );
+        JsonView.reset();
     }
 
-    auto Request::Cookie::operator[]( StrView Key ) const -> StrView
+    auto Request::Query::AppendEncoded( StrView EncodedPairs ) -> void
     {
-        if( EnvPtr == nullptr ) return {};
         using namespace ParseUtil;
-        auto CookieField = FCGX_GetParam( "HTTP_COOKIE", EnvPtr );
-        if( CookieField == nullptr ) return {};
-        for( auto Entry : CookieField | SplitBy( ';' ) )
-            for( auto [K, V] : Entry | SplitOnceBy( '=' ) | VIEW::transform( TrimSpace ) | VIEW::pairwise )
-                if( K == Key ) return V;
-        return {};
+        Materialize();
+        if( Buffer.length() + EncodedPairs.length() > NoEntry ) return;
+        Buffer.reserve( Buffer.length() + EncodedPairs.length() );  // decoded never longer
+        for( auto Segment : EncodedPairs | SplitBy( '&' ) )
+        {
+            auto Separator = std::min( Segment.find( '=' ), Segment.length() );
+            auto KeyOffset = Buffer.length();
+            DecodeURLFragment( Segment.substr( 0, Separator ), Buffer );
+            auto ValueOffset = Buffer.length();
+            DecodeURLFragment( Segment.substr( std::min( Separator + 1, Segment.length() ) ), Buffer );
+            if( ValueOffset == KeyOffset )  // empty key
+            {
+                Buffer.resize( KeyOffset );
+                continue;
+            }
+            Entries.push_back( { static_cast<std::uint32_t>( KeyOffset ), static_cast<std::uint32_t>( ValueOffset - KeyOffset ),  //
+                                 static_cast<std::uint32_t>( ValueOffset ), static_cast<std::uint32_t>( Buffer.length() - ValueOffset ),  //
+                                 NoEntry, NoEntry, 0 } );
+            IndexEntry( *this, static_cast<std::uint32_t>( Entries.size() - 1 ) );
+        }
+        JsonView.reset();
+    }
+
+    auto Request::Query::AppendJson( EasyFCGI::Json&& Body ) -> void
+    {
+        Materialize();
+        auto AppendValue = [this]( StrView Key, const EasyFCGI::Json& Value ) {
+            if( Value.is_string() )
+                Append( Key, Value.get_string() );
+            else
+                Append( Key, DumpJson( Value ) );
+        };
+        if( Body.is_object() )
+            for( auto& [Key, Value] : Body.get_object() )
+                if( Value.is_array() )
+                    for( auto& Element : Value.get_array() ) AppendValue( Key, Element );
+                else
+                    AppendValue( Key, Value );
+        JsonView = std::move( Body );
+    }
+
+    auto Request::Query::Json() const -> const EasyFCGI::Json&
+    {
+        Materialize();
+        if( ! JsonView.has_value() )
+        {
+            auto& Result = JsonView.emplace();
+            for( auto& E : Entries )
+            {
+                auto& Slot = Result[KeyOf( E )];
+                if( ! Slot.is_array() ) Slot = EasyFCGI::Json::array_t{};
+                Slot.get_array().emplace_back( std::string{ ValueOf( E ) } );
+            }
+        }
+        return *JsonView;
+    }
+
+    auto Request::Query::contains( StrView Key ) const -> bool { return Find( Key ) != NoEntry; }
+    auto Request::Query::CountRepeated( StrView Key ) const -> std::size_t
+    {
+        auto First = Find( Key );
+        return First == NoEntry ? 0 : Entries[First].Count;
+    }
+
+    auto Request::Query::GetOptional( StrView Key, std::size_t Index ) const -> std::optional<StrView>
+    {
+        auto Current = Find( Key );
+        for( ; Current != NoEntry && Index > 0; --Index ) Current = Entries[Current].NextSameKey;
+        if( Current == NoEntry ) return std::nullopt;
+        return ValueOf( Entries[Current] );
+    }
+    auto Request::Query::operator[]( StrView Key, std::size_t Index ) const -> StrView  //
+    {
+        return GetOptional( Key, Index ).value_or( StrView{} );
+    }
+
+    auto Request::Cookie::Bind( FastCGI::RequestContext* Context ) -> void
+    {
+        Entries.clear();
+        Slots.clear();
+        Decoded.clear();
+        Source = Context;
     }
 
-    static auto FullHeaderKey( StrView Key )
+    // "%XX" only, '+' and malformed escapes kept as is, unlike form decoding
+    static auto AppendPercentDecoded( StrView Encoded, std::string& Output ) -> StrView
     {
-        auto FullKey = "HTTP_{}"_FMT( Key );
-        for( auto& C : FullKey )
+        auto Offset = Output.length();
+        for( auto I = 0uz; I < Encoded.length(); ++I )
         {
-            if( C == '-' ) C = '_';
-            C = std::toupper( C );
+            auto High = Encoded[I] == '%' && I + 2 < Encoded.length() ? ParseUtil::HexDigitValue[static_cast<unsigned char>( Encoded[I + 1] )] : -1;
+            auto Low = High < 0 ? -1 : ParseUtil::HexDigitValue[static_cast<unsigned char>( Encoded[I + 2] )];
+            if( Low < 0 )
+                Output += Encoded[I];
+            else
+            {
+                Output += static_cast<char>( High << 4 | Low );
+                I += 2;
+            }
         }
-        return FullKey;
+        return StrView{ Output }.substr( Offset );
     }
 
-    auto Request::Header::operator[]( StrView Key ) const -> StrView
+    auto Request::Cookie::Materialize() const -> void
     {
-        if( auto Result = FCGX_GetParam( FullHeaderKey( Key ).c_str(), EnvPtr ) )  //
-            return Result;
-        return {};
+        auto Context = std::exchange( Source, nullptr );
+        if( Context == nullptr ) return;
+        auto Field = FastCGI::ParamOf( *Context, "HTTP_COOKIE" );
+        Decoded.reserve( Field.length() );  // never outgrown, views into it stay valid
+
+        auto Trim = []( StrView Input ) {
+            auto First = Input.find_first_not_of( " \t" );
+            if( First == StrView::npos ) return StrView{};
+            return Input.substr( First, Input.find_last_not_of( " \t" ) - First + 1 );
+        };
+
+        // "name1=value1; name2="value2"", pairs without '=' skipped
+        while( ! Field.empty() )
+        {
+            auto Pair = Field.substr( 0, Field.find( ';' ) );
+            Field.remove_prefix( std::min( Pair.length() + 1, Field.length() ) );
+            auto Separator = Pair.find( '=' );
+            if( Separator == StrView::npos ) continue;
+            auto Name = Trim( Pair.substr( 0, Separator ) );
+            auto Value = Trim( Pair.substr( Separator + 1 ) );
+            if( Name.empty() ) continue;
+            if( Value.length() >= 2 && Value.front() == '"' && Value.back() == '"' ) Value = Value.substr( 1, Value.length() - 2 );
+            if( Value.contains( '%' ) ) Value = AppendPercentDecoded( Value, Decoded );
+            Entries.emplace_back( Name, Value );
+        }
+
+        Slots.assign( std::max( 16uz, std::bit_ceil( Entries.size() * 2 ) ), NoEntry );
+        auto NameAt = [this]( std::uint32_t Index ) { return Entries[Index].first; };
+        for( auto&& [Index, E] : Entries | VIEW::enumerate )
+            if( auto& Slot = Slots[ProbeSlot( Slots, E.first, NameAt )]; Slot == NoEntry ) Slot = static_cast<std::uint32_t>( Index );  // first entry of name kept
+    }
+
+    auto Request::Cookie::Find( StrView Name ) const -> std::uint32_t
+    {
+        Materialize();
+        if( Slots.empty() ) return NoEntry;
+        return Slots[ProbeSlot( Slots, Name, [this]( std::uint32_t Index ) { return Entries[Index].first; } )];
+    }
+
+    auto Request::Cookie::operator[]( StrView Name ) const -> StrView
+    {
+        auto Index = Find( Name );
+        return Index == NoEntry ? StrView{} : Entries[Index].second;
     }
 
-    auto Request::Header::contains( StrView Key ) const -> bool  //
+    auto Request::Cookie::contains( StrView Name ) const -> bool { return Find( Name ) != NoEntry; }
+
+    auto Request::Cookie::size() const -> std::size_t
+    {
+        Materialize();
+        return Entries.size();
+    }
+
+    auto Request::Cookie::begin() const -> std::vector<Entry>::const_iterator
+    {
+        Materialize();
+        return Entries.cbegin();
+    }
+
+    auto Request::Cookie::end() const -> std::vector<Entry>::const_iterator
+    {
+        Materialize();
+        return Entries.cend();
+    }
+
+    // "User-Agent" as "HTTP_USER_AGENT", normalized on stack unless unusually long
+    static auto FindHeader( const FastCGI::RequestContext* Source, StrView Key ) -> std::optional<StrView>
+    {
+        if( Source == nullptr ) return std::nullopt;
+        char Buffer[128];
+        auto Overflow = std::string{};
+        auto FullKey = Buffer;
+        if( Key.length() + 5 > sizeof( Buffer ) )
+        {
+            Overflow.resize( Key.length() + 5 );
+            FullKey = Overflow.data();
+        }
+        std::copy_n( "HTTP_", 5, FullKey );
+        RNG::transform( Key, FullKey + 5, ParseUtil::CGIHeaderChar );
+        return Source->FindParam( ParseUtil::HashedKey{ StrView{ FullKey, Key.length() + 5 } } );
+    }
+
+    auto Request::Header::operator[]( StrView Key ) const -> StrView { return FindHeader( Source, Key ).value_or( StrView{} ); }
+
+    auto Request::Header::operator[]( ParseUtil::HashedKey Key ) const -> StrView
     {
-        return FCGX_GetParam( FullHeaderKey( Key ).c_str(), EnvPtr ) != nullptr;
+        if( Source == nullptr ) return {};
+        return Source->FindParam( Key ).value_or( StrView{} );
     }
 
+    auto Request::Header::contains( StrView Key ) const -> bool { return FindHeader( Source, Key ).has_value(); }
+
+    auto Request::Header::contains( ParseUtil::HashedKey Key ) const -> bool { return Source != nullptr && Source->FindParam( Key ).has_value(); }
+
     static auto NewFilePath( const FS::path& Path ) -> FS::path
     {
         auto ResultPath = Path;
@@ -291,6 +2738,22 @@ namespace EasyFCGI
                 case RenameNewFile : ResultPath = NewFilePath( Path ); break;
             }
 
+        // spooled upload : name the unnamed file, no copy, linked beside ResultPath then renamed over it
+        // already saved once : copied, so that no two saved paths share one file
+        // memfd or spool on other file system : written out below
+        struct stat SpoolStat{};
+        if( SpoolFD != -1 && ::fstat( SpoolFD, &SpoolStat ) == 0 && SpoolStat.st_nlink == 0 )
+        {
+            auto Staging = FS::path{ "{}.{}.spool"_FMT( ResultPath.string(), ::gettid() ) };
+            auto RenameError = std::error_code{};
+            if( ::linkat( AT_FDCWD, "/proc/self/fd/{}"_FMT( SpoolFD ).c_str(), AT_FDCWD, Staging.c_str(), AT_SYMLINK_FOLLOW ) == 0 )
+            {
+                FS::rename( Staging, ResultPath, RenameError );
+                if( ! RenameError ) return ResultPath;
+                FS::remove( Staging, RenameError );
+            }
+        }
+
         auto FileFD = fopen( ResultPath.c_str(), "wb" );
         std::fwrite( ContentBody.data(), sizeof( 1 [ContentBody.data()] ), ContentBody.size(), FileFD );
         std::fclose( FileFD );
@@ -298,8 +2761,34 @@ namespace EasyFCGI
         return ResultPath;
     };
 
+    auto Request::Files::Bind( FastCGI::RequestContext* Context ) -> void
+    {
+        Storage.clear();
+        Source = Context;
+    }
+
+    auto Request::Files::Materialize() const -> void
+    {
+        auto Context = std::exchange( Source, nullptr );
+        if( Context == nullptr ) return;
+        auto ContentTypeField = FastCGI::ParamOf( *Context, "CONTENT_TYPE" );
+        if( HTTP::ContentType::FromStringView( ContentTypeField ) != HTTP::ContentType::EnumValue::MULTIPART_FORM_DATA ) return;
+        if( Context->Spool != nullptr )
+        {
+            for( auto& Part : Context->Spool->Parts )
+                if( ! Part.ContentType.empty() && ( ! Part.FileName.empty() || Part.Length > 0 || ! Part.Content.empty() ) )  //
+                    Storage[Part.Name].push_back( { .FileName = Part.FileName, .ContentType = Part.ContentType, .ContentBody = Part.View(), .SpoolFD = Part.FD } );
+            return;
+        }
+        MultiPart::Scan( ContentTypeField, Context->StdIn, [this]( StrView Name, StrView FileName, StrView ContentType, StrView Content ) {
+            if( ! ContentType.empty() && ( ! FileName.empty() || ! Content.empty() ) )  //
+                Storage[Name].emplace_back( FileName, ContentType, Content );
+        } );
+    }
+
     auto Request::Files::operator[]( StrView Key, std::size_t Index ) const -> FileView
     {
+        Materialize();
         if( ! Storage.contains( Key ) ) return {};
         const auto& Slot = Storage.at( Key );
         if( Index < Slot.size() ) return Slot[Index];
@@ -308,17 +2797,16 @@ namespace EasyFCGI
 
     auto Request::GetParam( StrView ParamName ) const -> StrView
     {
-        if( FCGX_Request_Ptr == nullptr ) return {};
-        if( auto Result = FCGX_GetParam( std::data( ParamName ), FCGX_Request_Ptr->envp ) ) return Result;
-        return {};
+        if( FCGI_Request_Ptr == nullptr ) return {};
+        return FCGI_Request_Ptr->FindParam( ParseUtil::HashedKey{ ParamName } ).value_or( StrView{} );
     }
 
     auto Request::AllHeaderEntries() const -> std::vector<StrView>
     {
         auto Result = std::vector<StrView>{};
-        if( FCGX_Request_Ptr == nullptr ) return Result;
-        Result.reserve( 100 );
-        for( auto EnvP = FCGX_Request_Ptr->envp; EnvP != nullptr && *EnvP != nullptr; ++EnvP )
+        if( FCGI_Request_Ptr == nullptr ) return Result;
+        Result.reserve( FCGI_Request_Ptr->Environment.size() );
+        for( auto EnvP = FCGI_Request_Ptr->Environment.data(); *EnvP != nullptr; ++EnvP )
         {
             Result.push_back( *EnvP );
         }
@@ -327,185 +2815,112 @@ namespace EasyFCGI
 
     auto Request::Accept() -> int
     {
-        if( FCGX_Request_Ptr == nullptr )
+        if( FCGI_Request_Ptr == nullptr )
         {
-            std::println( "[ Fail ] Invoking Request::Accept() with null FCGX_Request_Ptr always fails." );
+            std::println( "[ Fail ] Invoking Request::Accept() with null FCGI_Request_Ptr always fails." );
             return -1;
         }
 
-        if( FCGX_Accept_r( FCGX_Request_Ptr.get() ) == 0 )
+        auto& Engine = FastCGI::Engine::Attach( FCGI_Request_Ptr->ListenSocket );
+        while( auto NextRequest = Engine.NextRequest() )
         {
+            FCGI_Request_Ptr = std::move( NextRequest );  // previous request, if any, finishes here
+            if( ! FCGI_Request_Ptr->Admit() )
+            {
+                // overloaded, shed before parsing, caller does not see this request
+                Send( "Status: 503\r\n"
+                      "Retry-After: 1\r\n"
+                      "Content-Type: text/html; charset=UTF-8\r\n"
+                      "\r\n"
+                      "Service Unavailable." );
+                FCGI_Request_Ptr->Finish();  // respond now, not when next request arrives
+                continue;
+            }
             if( Parse() == 0 ) return 0;
-            return Accept();  // invalid request, accept new request
+            FCGI_Request_Ptr->Finish();  // invalid request responded, accept new request
         }
 
-        // fail to obtain valid request, reset residual request data & allocation
-        // custom deleter of FCGX_Request_Ptr will do the cleanup
-        FCGX_InitRequest( FCGX_Request_Ptr.get(), {}, {} );
-        FCGX_Request_Ptr.reset();
+        // fail to obtain valid request
+        FCGI_Request_Ptr.reset();
 
-        if( TerminationRequested() ) std::println( "Interrupted FCGX_Accept_r()." );
+        if( TerminationRequested() ) std::println( "Interrupted Request::Accept()." );
         return -1;
     }
 
+    // cheap part only, each facet decoded on its first access
+    // except a Json body, checked in full here so that a malformed one is answered with 400 before the handler
     auto Request::Parse() -> int
     {
         using namespace ParseUtil;
-        Query.Json.reset();
-        Files.Storage.clear();
-        Payload.clear();
+        Query.Bind( FCGI_Request_Ptr.get() );
+        Files.Bind( FCGI_Request_Ptr.get() );
 
-        Header.EnvPtr = FCGX_Request_Ptr->envp;
-        Cookie.EnvPtr = FCGX_Request_Ptr->envp;
+        Header.Source = FCGI_Request_Ptr.get();
+        Cookie.Bind( FCGI_Request_Ptr.get() );
 
         Method = GetParam( "REQUEST_METHOD" );
         ContentType = GetParam( "CONTENT_TYPE" );
 
-        Payload.resize_and_overwrite( ( GetParam( "CONTENT_LENGTH" ) | ConvertTo<int> | FallBack( 0 ) ) + 1,  //
-                                      [Stream = FCGX_Request_Ptr->in]( char* Buffer, std::size_t N ) {        //
-                                          return FCGX_GetStr( Buffer, N, Stream );
-                                      } );
-
-        auto QueryAppend = [&Result = Query.Json]( std::string_view Key, auto&& Value ) {
-            if( Key.empty() ) return;
-            if( ! Result.contains( Key ) || ! Result[Key].is_array() ) Result[Key] = Json::array_t{};
-            Result[Key].get_array().push_back( std::forward<decltype( Value )>( Value ) );
-        };
-
-        {
-            // read query string, then request body
-            // duplicated key-value will be overwritten
-            for( auto Segment : GetParam( "QUERY_STRING" ) | SplitBy( '&' ) )
-                for( auto [EncodedKey, EncodedValue] : Segment | SplitOnceBy( '=' ) | VIEW::pairwise )
-                    QueryAppend( DecodeURLFragment( EncodedKey ), DecodeURLFragment( EncodedValue ) );
+        Payload = FCGI_Request_Ptr->StdIn;  // assembled by reactor already
 
-            switch( ContentType )
+        // invalid Json body answered with 400 before the handler, validation builds no tree
+        if( ContentType.Type == HTTP::ContentType::EnumValue::APPLICATION_JSON )
+            if( auto Error = glz::validate_json( FCGI_Request_Ptr->StdIn ) )
             {
-                default : break;
-                case HTTP::Content::Application::FormURLEncoded :
-                {
-                    for( auto Segment : Payload | SplitBy( '&' ) )
-                        for( auto [EncodedKey, EncodedValue] : Segment | SplitOnceBy( '=' ) | VIEW::pairwise )
-                            QueryAppend( DecodeURLFragment( EncodedKey ), DecodeURLFragment( EncodedValue ) );
-                    break;
-                }
-                case HTTP::Content::MultiPart::FormData :
-                {
-                    // remark: by RFC 2046, boundary is at most 70 character long
-                    constexpr auto BoundaryLengthLimit = 70uz;
-                    auto BoundaryPattern = GetParam( "CONTENT_TYPE" ) | After( "boundary=" ) | TrimSpace;
-                    if( BoundaryPattern.length() > BoundaryLengthLimit )  //
-                        [[unlikely]]
-                        break;
-
-                    // remove trailing boundary to avoid empty ending after split
-                    auto PayloadView = Payload                            //
-                                       | TrimSpace                        //
-                                       | TrimTrailing( "--" )             //
-                                       | TrimTrailing( BoundaryPattern )  //
-                                       | TrimTrailing( "\r\n--" );
-                    if( PayloadView.empty() )  //
-                        [[unlikely]]
-                        break;
-
-                    // constexpr auto ExtendedBoundaryFormatString = StrView{ "\r\n--{}\r\nContent-Disposition: form-data; name=" };
-                    // char ExtendedBoundaryBuffer[BoundaryLengthLimit + ExtendedBoundaryFormatString.length() - 2];
-                    // auto ExtendedBoundaryFormatResult = std::format_to_n( ExtendedBoundaryBuffer, std::size( ExtendedBoundaryBuffer ),  //
-                    //                                                       ExtendedBoundaryFormatString, BoundaryPattern );
-                    // auto ExtendedBoundary = StrView{ ExtendedBoundaryBuffer, ExtendedBoundaryFormatResult.out };
-                    auto ExtendedBoundaryBuffer = std::format( "\r\n--{}\r\nContent-Disposition: form-data; name=", BoundaryPattern );
-                    auto ExtendedBoundary = StrView{ ExtendedBoundaryBuffer };
-                    // Remark: ExtendedBoundary is not standard conformant to disallow white space after BoundaryPattern
-
-                    PayloadView = PayloadView | TrimLeading( ExtendedBoundary.substr( 2 ) );
-
-                    // at this point, PayloadView does not contain ExtendedBoundary on both ends.
-
-                    for( auto&& PayloadFragment : PayloadView | SplitBy( ExtendedBoundary ) )
-                    {
-                        auto [Header, Content] = PayloadFragment | SplitOnceBy( "\r\n\r\n" );
-
-                        auto Name = Header | Between( '"' );
-                        auto FileName = Header | After( "filename=" ) | Between( '"' );
-                        auto ContentType = Header | After( "\r\n" ) | After( "Content-Type:" ) | TrimSpace;
+                Send( "Status: 400\r\n"
+                      "Content-Type: text/html; charset=UTF-8\r\n"
+                      "\r\n"
+                      "Invalid Json." );
+                std::println( "{}\nResponding 400 Bad Request to Request with invalid Json.", glz::format_error( Error, FCGI_Request_Ptr->StdIn ) );
+                std::fflush( stdout );
+                return -1;
+            }
 
-                        if( Name.empty() )  // should never happen?
-                            [[unlikely]]
-                            break;
+        if( Config::RequestTimeout > 0ms ) SetDeadline( Config::RequestTimeout );
+        if( auto UpstreamTimeout = Header["X-Request-Timeout"_Header] | ConvertTo<int> | FallBack( 0 ); UpstreamTimeout > 0 )
+            SetDeadline( std::chrono::milliseconds{ UpstreamTimeout } );
 
-                        if( ContentType.empty() )
-                        {
-                            QueryAppend( Name, Content );
-                        }
-                        else
-                        {
-                            QueryAppend( Name, FileName );
-                            if( ! FileName.empty() || ! Content.empty() )  //
-                                Files.Storage[Name].emplace_back( FileName, ContentType, Content );
-                        }
-                    }
-                    break;
-                }
-                case HTTP::Content::Application::Json :
-                {
-                    auto ParseResult = glz::read_json( Query.Json, Payload );
-                    if( ParseResult != glz::error_code::none )
-                    {  // parse error
-                        // early response with error message
-                        // caller does not see this iteration
-                        // give caller the next request
-                        FCGX_PutS( "Status: 400\r\n"
-                                   "Content-Type: text/html; charset=UTF-8\r\n"
-                                   "\r\n"
-                                   "Invalid Json.",
-                                   FCGX_Request_Ptr->out );
-
-                        std::println( "{}\n", ParseResult.custom_error_message );
-                        std::println( "Responding 400 Bad Request to Request with invalid Json.\nReady to accept new request..." );
-                        std::fflush( stdout );
-                        return -1;
-                    }
-                    break;
-                }
-            }
-        }
         return 0;
     }
 
-    Request::operator bool() const { return FCGX_Request_Ptr != nullptr; }
+    Request::operator bool() const { return FCGI_Request_Ptr != nullptr; }
 
     Request::Request( SocketFileDescriptor SocketFD )  //
-        : FCGX_Request_Ptr{ std::make_unique_for_overwrite<FCGX_Request>().release() }
+        : FCGI_Request_Ptr{ std::make_unique<FastCGI::RequestContext>() }
     {
-        auto Request_Ptr = FCGX_Request_Ptr.get();
-        std::ignore = FCGX_InitRequest( Request_Ptr, SocketFD, FCGI_FAIL_ACCEPT_ON_INTR );
-        Request_Ptr->keepConnection = 0;  // disable fastcgi_keep_conn
+        FCGI_Request_Ptr->ListenSocket = SocketFD;
     }
 
     Request& Request::operator=( Request&& Other ) & = default;
 
-    auto Request::empty() const -> bool { return FCGX_Request_Ptr == nullptr; }
+    auto Request::empty() const -> bool { return FCGI_Request_Ptr == nullptr; }
 
     auto Request::operator[]( StrView Key, std::size_t Index ) const -> decltype( Query[{}, {}] ) { return Query[Key, Index]; }
 
-    static auto OutputIteratorFor( const std::unique_ptr<FCGX_Request>& FCGX_Request_Ptr )
+    auto Request::RespondBadRequest( StrView Message ) -> void
+    {
+        if( Response.StatusCode == HTTP::StatusCode::InternalUse_HeaderAlreadySent ) return;
+        Response.Reset().Set( HTTP::StatusCode::BadRequest ).SetBody( std::string{ Message } );
+    }
+
+    static auto OutputIteratorFor( const std::unique_ptr<FastCGI::RequestContext>& FCGI_Request_Ptr )
     {
         struct OutIt
         {
             using difference_type = std::ptrdiff_t;
-            FCGX_Stream* Out;
+            FastCGI::RequestContext* Out;
             auto operator*() const { return *this; }
             auto& operator++() & { return *this; }
             auto operator++( int ) const { return *this; }
-            auto operator=( char C ) const { return FCGX_PutChar( C, Out ); }
+            auto operator=( char C ) const { return Out->Put( StrView{ &C, 1 } ); }
         };
-        return OutIt{ FCGX_Request_Ptr->out };
+        return OutIt{ FCGI_Request_Ptr.get() };
     }
 
     auto Request::Send( StrView Content ) const -> void
     {
-        if( Content.empty() || FCGX_Request_Ptr == nullptr ) return;
-        FCGX_PutStr( Content.data(), Content.length(), FCGX_Request_Ptr->out );
+        if( Content.empty() || FCGI_Request_Ptr == nullptr ) return;
+        FCGI_Request_Ptr->Put( Content );
     }
 
     auto Request::SendLine( StrView Content ) const -> void
@@ -530,18 +2945,38 @@ namespace EasyFCGI
         for( auto&& [K, V] : Response.Cookie ) SendLine( "Set-Cookie: {}={}"_FMT( K, V ) );
         for( auto&& [K, V] : Response.Header ) SendLine( "{}: {}"_FMT( K, V ) );
         SendLine();
-        FCGX_FFlush( FCGX_Request_Ptr->out );
+        Flush();
 
         return std::exchange( Response.StatusCode, InternalUse_HeaderAlreadySent );
     }
 
-    auto Request::FlushResponse() -> decltype( FCGX_FFlush( {} ) )
+    auto Request::FlushResponse() -> int
     {
         Send( Response.Body );
         Response.Body.clear();
-        return FCGX_FFlush( FCGX_Request_Ptr->out );
+        return Flush();
+    }
+
+    auto Request::Flush() const -> int
+    {
+        if( FCGI_Request_Ptr == nullptr || FCGI_Request_Ptr->Cancellation.stop_requested() ) return -1;
+        return FCGI_Request_Ptr->Flush();
+    }
+
+    auto Request::StopToken() const -> std::stop_token
+    {
+        if( FCGI_Request_Ptr == nullptr ) return {};
+        return FCGI_Request_Ptr->Cancellation.get_token();
     }
 
+    auto Request::SetDeadline( Clock::duration Budget ) -> void
+    {
+        if( FCGI_Request_Ptr == nullptr ) return;
+        FCGI_Request_Ptr->SetDeadline( FCGI_Request_Ptr->ReadyTime + Budget );
+    }
+
+    auto Request::FlushAsync() const -> Async::FlushAwaiter { return { *this }; }
+
     auto Request::EarlyFinish() -> void { std::exchange( *this, {} ); }
 
     auto Request::SSE_Start() -> void
@@ -559,12 +2994,12 @@ namespace EasyFCGI
         FlushResponse();
     }
 
-    auto Request::SSE_Error() const -> decltype( FCGX_GetError( {} ) ) { return FCGX_GetError( FCGX_Request_Ptr->out ); }
+    auto Request::SSE_Error() const -> int { return FCGI_Request_Ptr == nullptr ? -1 : FCGI_Request_Ptr->Error; }
 
     auto Request::Dump() const -> std::string
     {
         auto Result = std::string{};
-        if( FCGX_Request_Ptr == nullptr ) Result += "[Dump] This request object is not attached to an actual request.\n";
+        if( FCGI_Request_Ptr == nullptr ) Result += "[Dump] This request object is not attached to an actual request.\n";
         Result += std::format( "Method: [{}]\n", Method );
         Result += std::format( "Content Type: [{}]\n", ContentType );
         Result += "Header: [\n";
@@ -579,11 +3014,12 @@ namespace EasyFCGI
 
         Result += std::format( "{:-^50}\n", "" );
 
-        if( Query.Json.empty() )
+        if( Query.Json().empty() )
             Result += "Query Json: []\n";
         else
-            Result += std::format( "Query Json: [\n{}\n]\n", glz::write<glz::opts{ .prettify = true }>( Query.Json ).value_or( "{}" ) );
+            Result += std::format( "Query Json: [\n{}\n]\n", glz::write<glz::opts{ .prettify = true }>( Query.Json() ).value_or( "{}" ) );
 
+        Files.Materialize();
         if( Files.Storage.empty() )
             Result += "Files: []\n";
         else
@@ -600,12 +3036,11 @@ namespace EasyFCGI
 
     Request::~Request()
     {
-        if( FCGX_Request_Ptr == nullptr ) return;
-        // std::println( "ID: [ {:2},{:2} ] Request Complete...", FCGX_Request_Ptr->ipcFd, FCGX_Request_Ptr->requestId );
+        if( FCGI_Request_Ptr == nullptr ) return;
+        // std::println( "ID: [ {:2} ] Request Complete...", FCGI_Request_Ptr->RequestId );
         if( FlushHeader() != HTTP::StatusCode::NoContent ) FlushResponse();
-        FCGX_Request_Ptr->keepConnection = 0;  // just in case
-        FCGX_Finish_r( FCGX_Request_Ptr.get() );
-        FCGX_Request_Ptr.reset();
+        FCGI_Request_Ptr->Finish();
+        FCGI_Request_Ptr.reset();
         std::fflush( stdout );  // flush log
         std::fflush( stderr );
     }
@@ -617,16 +3052,320 @@ namespace EasyFCGI
 
         if( getsockname( FD, (sockaddr*)&UnixAddr, &UnixAddrLen ) == 0 )
         {
+            auto EC = std::error_code{};  // socket file removed, or abstract address
             switch( UnixAddr.sun_family )
             {
                 case AF_UNIX :
-                    return FS::canonical( UnixAddr.sun_path );
+                    return FS::canonical( UnixAddr.sun_path, EC );
                     // case AF_INET : return "0.0.0.0";
             }
         }
         return {};
     }
 
+    // accepted connections inherit buffer sizes from the listener
+    static auto TuneSocketBuffers( SocketFileDescriptor FD ) -> void
+    {
+        if( Config::ReceiveBufferSize > 0 ) ::setsockopt( FD, SOL_SOCKET, SO_RCVBUF, &Config::ReceiveBufferSize, sizeof( int ) );
+        if( Config::SendBufferSize > 0 ) ::setsockopt( FD, SOL_SOCKET, SO_SNDBUF, &Config::SendBufferSize, sizeof( int ) );
+    }
+
+    // "HOST:PORT", "[IPV6]:PORT", ":PORT" or "*:PORT" for all interfaces
+    // Return: { Host, Port }, Host empty for all interfaces
+    static auto TCPAddress( StrView Address ) -> std::optional<std::pair<std::string, std::string>>
+    {
+        auto Colon = Address.rfind( ':' );
+        if( Address.contains( '/' ) || Colon == StrView::npos || Colon + 1 == Address.length() ) return std::nullopt;
+        auto Host = Address.substr( 0, Colon );
+        auto Port = Address.substr( Colon + 1 );
+        auto PortNumber = Port | ConvertTo<int> | ParseUtil::FallBack( 0 );
+        if( PortNumber <= 0 || PortNumber > 0xFFFF ) return std::nullopt;
+        if( Host.starts_with( '[' ) && Host.ends_with( ']' ) ) Host = Host.substr( 1, Host.length() - 2 );
+        if( Host == "*" ) Host = {};
+        return std::pair{ std::string{ Host }, std::string{ Port } };
+    }
+
+    static auto TCPSocketName( SocketFileDescriptor FD ) -> std::string
+    {
+        auto Addr = sockaddr_storage{};
+        auto AddrLen = socklen_t{ sizeof( Addr ) };
+        if( ::getsockname( FD, (sockaddr*)&Addr, &AddrLen ) != 0 || ( Addr.ss_family != AF_INET && Addr.ss_family != AF_INET6 ) ) return {};
+        char Host[NI_MAXHOST]{};
+        char Port[NI_MAXSERV]{};
+        if( ::getnameinfo( (sockaddr*)&Addr, AddrLen, Host, sizeof( Host ), Port, sizeof( Port ), NI_NUMERICHOST | NI_NUMERICSERV ) != 0 ) return {};
+        return Addr.ss_family == AF_INET6 ? "[{}]:{}"_FMT( Host, Port ) : "{}:{}"_FMT( Host, Port );
+    }
+
+    static auto OpenTCPSocket( const std::pair<std::string, std::string>& Address, int BackLogNumber ) -> SocketFileDescriptor
+    {
+        auto& [Host, Port] = Address;
+        auto Hints = addrinfo{ .ai_flags = AI_PASSIVE, .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+        auto Candidates = (addrinfo*){};
+        if( auto Error = ::getaddrinfo( Host.empty() ? nullptr : Host.c_str(), Port.c_str(), &Hints, &Candidates ); Error != 0 )
+        {
+            std::println( "[ Error ] {}\n Fail to resolve listen address {}:{}", ::gai_strerror( Error ), Host, Port );
+            return -1;
+        }
+
+        auto FD = SocketFileDescriptor{ -1 };
+        for( auto Candidate = Candidates; Candidate != nullptr && FD == -1; Candidate = Candidate->ai_next )
+        {
+            FD = ::socket( Candidate->ai_family, Candidate->ai_socktype | SOCK_CLOEXEC, Candidate->ai_protocol );
+            if( FD == -1 ) continue;
+
+            auto Enable = 1;
+            ::setsockopt( FD, SOL_SOCKET, SO_REUSEADDR, &Enable, sizeof( Enable ) );  // rebind while old connections in TIME_WAIT
+            if( Config::ReusePort ) ::setsockopt( FD, SOL_SOCKET, SO_REUSEPORT, &Enable, sizeof( Enable ) );
+            ::setsockopt( FD, IPPROTO_TCP, TCP_NODELAY, &Enable, sizeof( Enable ) );  // inherited by accepted connections
+            if( auto DeferSeconds = static_cast<int>( Config::DeferAccept.count() ); DeferSeconds > 0 )
+                ::setsockopt( FD, IPPROTO_TCP, TCP_DEFER_ACCEPT, &DeferSeconds, sizeof( DeferSeconds ) );
+            TuneSocketBuffers( FD );
+
+            if( ::bind( FD, Candidate->ai_addr, Candidate->ai_addrlen ) == 0 && ::listen( FD, BackLogNumber ) == 0 ) break;
+            std::println( "[ Error {} ] {}\n Fail to listen on {}:{}", errno, strerrordesc_np( errno ), Host, Port );
+            ::close( std::exchange( FD, -1 ) );
+        }
+        ::freeaddrinfo( Candidates );
+        return FD;
+    }
+
+    // socket file left by a process no longer listening, connection refused
+    static auto RemoveStaleSocket( const sockaddr_un& UnixAddr ) -> bool
+    {
+        auto FD = ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+        if( FD == -1 ) return false;
+        auto Refused = ::connect( FD, (const sockaddr*)&UnixAddr, sizeof( UnixAddr ) ) == -1 && errno == ECONNREFUSED;
+        ::close( FD );
+        return Refused && ::unlink( UnixAddr.sun_path ) == 0;
+    }
+
+    static auto OpenUnixSocket( const FS::path& SocketPath, int BackLogNumber ) -> SocketFileDescriptor
+    {
+        auto UnixAddr = sockaddr_un{ .sun_family = AF_UNIX, .sun_path = {} };
+        if( SocketPath.native().length() >= sizeof( UnixAddr.sun_path ) )
+        {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        RNG::copy( SocketPath.native(), UnixAddr.sun_path );
+
+        auto FD = ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+        if( FD == -1 ) return -1;
+        TuneSocketBuffers( FD );
+        auto Bind = [&] { return ::bind( FD, (sockaddr*)&UnixAddr, sizeof( UnixAddr ) ) == 0; };
+        if( ( Bind() || ( errno == EADDRINUSE && RemoveStaleSocket( UnixAddr ) && Bind() ) ) && ::listen( FD, BackLogNumber ) == 0 )
+        {
+            FS::permissions( SocketPath, FS::perms::all );
+            return FD;
+        }
+        ::close( FD );
+        return -1;
+    }
+
+    // listen sockets opened before this process started, the kernel queues connections meanwhile
+    namespace Inherited
+    {
+        constexpr auto FirstActivationFD = 3;  // SD_LISTEN_FDS_START
+
+        static auto IsListenSocket( int FD ) -> bool
+        {
+            auto Listening = 0;
+            auto Length = socklen_t{ sizeof( Listening ) };
+            return ::getsockopt( FD, SOL_SOCKET, SO_ACCEPTCONN, &Listening, &Length ) == 0 && Listening != 0;
+        }
+
+        // collected on first call, which must happen before fork() / daemon() changes the pid
+        static auto Sockets() -> std::vector<SocketFileDescriptor>&
+        {
+            static auto Sockets = [] {
+                auto Result = std::vector<SocketFileDescriptor>{};
+                auto EnvironmentValue = []( const char* Name ) {
+                    auto Value = std::getenv( Name );
+                    return Value == nullptr ? 0 : Value | ConvertTo<int> | ParseUtil::FallBack( 0 );
+                };
+
+                // systemd socket activation, see sd_listen_fds(3)
+                if( EnvironmentValue( "LISTEN_PID" ) == ::getpid() )
+                    for( auto FD : VIEW::iota( FirstActivationFD, FirstActivationFD + EnvironmentValue( "LISTEN_FDS" ) ) ) Result.push_back( FD );
+                ::unsetenv( "LISTEN_PID" );  // not meant for child processes
+                ::unsetenv( "LISTEN_FDS" );
+                ::unsetenv( "LISTEN_FDNAMES" );
+
+                if( auto FD = Config::LaunchOptionValue( "listen-fd" ).and_then( ConvertTo<int> ); FD.has_value() ) Result.push_back( *FD );
+
+                std::erase_if( Result, []( int FD ) {
+                    if( IsListenSocket( FD ) ) return false;
+                    std::println( "[ Warning ] Inherited file descriptor {} is not a listening socket, ignored", FD );
+                    return true;
+                } );
+                for( auto FD : Result ) ::fcntl( FD, F_SETFD, FD_CLOEXEC );
+                return Result;
+            }();
+            return Sockets;
+        }
+
+        // Return: inherited socket bound to SocketPath, otherwise any left unclaimed, -1 if none
+        static auto Claim( const FS::path& SocketPath ) -> SocketFileDescriptor
+        {
+            auto& Unclaimed = Sockets();
+            if( Unclaimed.empty() ) return -1;
+            auto EC = std::error_code{};
+            auto Target = FS::weakly_canonical( SocketPath, EC );
+            auto Found = RNG::find_if( Unclaimed, [&]( int FD ) { return ! Target.empty() && UnixSocketName( FD ) == Target; } );
+            if( Found == Unclaimed.end() ) Found = Unclaimed.begin();
+            auto FD = *Found;
+            Unclaimed.erase( Found );
+            std::println( "[ OK ]  Inherited listen socket {}", FD );
+            return FD;
+        }
+    }  // namespace Inherited
+
+    // zero downtime restart, listen socket passed from running instance to its successor ( SCM_RIGHTS )
+    // successor acknowledges once ready to accept, predecessor then drains and exits
+    // both accept on the same socket meanwhile, upstream never sees it closed
+    namespace Handover
+    {
+        static auto Predecessor = -1;  // connection kept until Acknowledge()
+        static auto Received = std::pair<FS::path, SocketFileDescriptor>{ {}, -1 };
+
+        static auto EndpointFor( const FS::path& SocketPath ) -> FS::path { return FS::path{ SocketPath } += ".handover"; }
+
+        static auto Connect( const FS::path& Endpoint ) -> int
+        {
+            auto UnixAddr = sockaddr_un{ .sun_family = AF_UNIX, .sun_path = {} };
+            if( Endpoint.native().length() >= sizeof( UnixAddr.sun_path ) ) return -1;
+            RNG::copy( Endpoint.native(), UnixAddr.sun_path );
+
+            auto FD = ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+            if( FD == -1 ) return -1;
+            if( ::connect( FD, (sockaddr*)&UnixAddr, sizeof( UnixAddr ) ) == 0 ) return FD;
+            ::close( FD );
+            return -1;
+        }
+
+        // Return: listen socket of running instance, -1 if none
+        // repeated calls return the socket already received
+        static auto Receive( const FS::path& SocketPath ) -> SocketFileDescriptor
+        {
+            if( Received.second != -1 ) return Received.first == SocketPath ? Received.second : -1;
+            if( SocketPath.empty() ) return -1;
+            auto FD = Connect( EndpointFor( SocketPath ) );
+            if( FD == -1 ) return -1;
+
+            auto Timeout = timeval{ .tv_sec = 5, .tv_usec = 0 };  // predecessor stuck, fall back to fresh socket
+            ::setsockopt( FD, SOL_SOCKET, SO_RCVTIMEO, &Timeout, sizeof( Timeout ) );
+
+            auto Byte = char{};
+            auto IOV = iovec{ .iov_base = &Byte, .iov_len = 1 };
+            alignas( cmsghdr ) char Control[CMSG_SPACE( sizeof( int ) )]{};
+            auto Message = msghdr{ .msg_name = nullptr, .msg_namelen = 0, .msg_iov = &IOV, .msg_iovlen = 1,  //
+                                   .msg_control = Control, .msg_controllen = sizeof( Control ), .msg_flags = 0 };
+            auto ListenSocket = SocketFileDescriptor{ -1 };
+            if( ::recvmsg( FD, &Message, MSG_CMSG_CLOEXEC ) == 1 )
+                if( auto CMSG = CMSG_FIRSTHDR( &Message ); CMSG != nullptr && CMSG->cmsg_level == SOL_SOCKET && CMSG->cmsg_type == SCM_RIGHTS )
+                    std::memcpy( &ListenSocket, CMSG_DATA( CMSG ), sizeof( ListenSocket ) );
+
+            if( ListenSocket == -1 )
+            {
+                std::println( "[ Warning ] Socket handover failed, open new socket instead" );
+                ::close( FD );
+                return -1;
+            }
+            std::println( "[ OK ]  Handover : listen socket received from running instance" );
+            Predecessor = FD;
+            Received = { SocketPath, ListenSocket };
+            return ListenSocket;
+        }
+
+        // predecessor starts draining
+        static auto Acknowledge() -> void
+        {
+            if( Predecessor == -1 ) return;
+            ::send( Predecessor, "R", 1, MSG_NOSIGNAL );
+            ::close( std::exchange( Predecessor, -1 ) );
+        }
+
+        // hand ListenSocket to the first successor that acknowledges, then terminate this process
+        static auto Serve( SocketFileDescriptor ListenSocket, const FS::path& SocketPath ) -> void
+        {
+            auto Endpoint = EndpointFor( SocketPath );
+            auto UnixAddr = sockaddr_un{ .sun_family = AF_UNIX, .sun_path = {} };
+            if( SocketPath.empty() || Endpoint.native().length() >= sizeof( UnixAddr.sun_path ) ) return;
+            RNG::copy( Endpoint.native(), UnixAddr.sun_path );
+
+            auto EndpointFD = ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+            ::unlink( Endpoint.c_str() );  // left by predecessor
+            if( EndpointFD == -1 || ::bind( EndpointFD, (sockaddr*)&UnixAddr, sizeof( UnixAddr ) ) != 0 ||  //
+                ::chmod( Endpoint.c_str(), S_IRUSR | S_IWUSR ) != 0 || ::listen( EndpointFD, 1 ) != 0 )
+            {
+                std::println( "[ Error {} ] {}\n Fail to open handover endpoint : {}", errno, strerrordesc_np( errno ), Endpoint.c_str() );
+                if( EndpointFD != -1 ) ::close( EndpointFD );
+                return;
+            }
+
+            std::thread{ [=] {
+                // termination signal goes to other threads, interrupting their blocking calls
+                auto BlockAll = sigset_t{};
+                sigfillset( &BlockAll );
+                ::pthread_sigmask( SIG_BLOCK, &BlockAll, nullptr );
+
+                while( true )
+                {
+                    auto FD = ::accept4( EndpointFD, nullptr, nullptr, SOCK_CLOEXEC );
+                    if( FD == -1 )
+                    {
+                        if( errno == EINTR || errno == ECONNABORTED ) continue;
+                        if( ! SleepFor( 1s ) ) return;  // EMFILE and alike persist, back off instead of spinning
+                        continue;
+                    }
+
+                    auto Peer = ucred{};
+                    auto PeerLen = socklen_t{ sizeof( Peer ) };
+                    if( ::getsockopt( FD, SOL_SOCKET, SO_PEERCRED, &Peer, &PeerLen ) != 0 || ( Peer.uid != ::getuid() && Peer.uid != 0 ) )
+                    {
+                        ::close( FD );
+                        continue;
+                    }
+
+                    auto Timeout = timeval{ .tv_sec = 5, .tv_usec = 0 };  // successor stuck before Acknowledge(), serve the next one
+                    ::setsockopt( FD, SOL_SOCKET, SO_RCVTIMEO, &Timeout, sizeof( Timeout ) );
+
+                    auto Byte = char{ 'L' };
+                    auto IOV = iovec{ .iov_base = &Byte, .iov_len = 1 };
+                    alignas( cmsghdr ) char Control[CMSG_SPACE( sizeof( int ) )]{};
+                    auto Message = msghdr{ .msg_name = nullptr, .msg_namelen = 0, .msg_iov = &IOV, .msg_iovlen = 1,  //
+                                           .msg_control = Control, .msg_controllen = sizeof( Control ), .msg_flags = 0 };
+                    auto CMSG = CMSG_FIRSTHDR( &Message );
+                    CMSG->cmsg_level = SOL_SOCKET;
+                    CMSG->cmsg_type = SCM_RIGHTS;
+                    CMSG->cmsg_len = CMSG_LEN( sizeof( int ) );
+                    std::memcpy( CMSG_DATA( CMSG ), &ListenSocket, sizeof( ListenSocket ) );
+
+                    // successor gone before acknowledging, keep serving
+                    auto Acknowledged = ::sendmsg( FD, &Message, MSG_NOSIGNAL ) == 1 && ::recv( FD, &Byte, 1, 0 ) == 1;
+                    ::close( FD );
+                    if( ! Acknowledged ) continue;
+
+                    std::println( "[ OK ]  Handover : successor ready, draining" );
+                    std::fflush( stdout );
+                    ::close( EndpointFD );  // endpoint path now belongs to successor
+                    ::kill( ::getpid(), SIGTERM );
+                    return;
+                }
+            } }.detach();
+        }
+    }  // namespace Handover
+
+    // listen socket inherited or handed over by running instance, otherwise a fresh one
+    static auto OpenListenSocket( const FS::path& SocketPath ) -> SocketFileDescriptor
+    {
+        if( auto FD = Inherited::Claim( SocketPath ); FD != -1 ) return FD;
+        if( Config::SocketHandover )
+            if( auto FD = Handover::Receive( SocketPath ); FD != -1 ) return FD;
+        if( auto Address = TCPAddress( SocketPath.native() ) ) return OpenTCPSocket( *Address, Config::DefaultBackLogNumber );
+        return OpenUnixSocket( SocketPath, Config::DefaultBackLogNumber );
+    }
+
     namespace ConfigureIO
     {
         constexpr auto Coalesce = []( FS::path& P, FS::path&& F ) static -> const FS::path& {
@@ -648,11 +3387,22 @@ namespace EasyFCGI
 
         static void PrepareSocket()
         {
-            Prepare( Coalesce( Config::SokcetPath, Config::LaunchOptionValue( "socket" ).transform( ToPath ).value_or( Config::CWD / "run" / ( Config::ScriptName + ".sock" ) ) ) );
-            /// TODO:
-            // check if socket is in use
-            // open socket and try listen
-            // or maybe exit()?
+            Coalesce( Config::SokcetPath, Config::LaunchOptionValue( "socket" ).transform( ToPath ).value_or( Config::CWD / "run" / ( Config::ScriptName + ".sock" ) ) );
+            if( ! Inherited::Sockets().empty() || TCPAddress( Config::SokcetPath.native() ) ) return;
+            Prepare( Config::SokcetPath );
+            // running instance keeps serving until this one is ready, instead of being terminated by RedirectIO
+            if( Config::SocketHandover && Handover::Receive( Config::SokcetPath ) != -1 ) return;
+            // a live socket is never taken silently, stale ones are removed by OpenUnixSocket
+            auto FD = Handover::Connect( Config::SokcetPath );
+            if( FD == -1 ) return;
+            ::close( FD );
+            if( ! Config::SocketHandover )
+            {
+                std::println( "[ Fatal ] Socket {} in use by another process\n Stop it first, or restart with --handover", Config::SokcetPath.c_str() );
+                std::exit( EADDRINUSE );
+            }
+            std::println( "[ Warning ] Socket {} in use by a process not handing it over, replacing it", Config::SokcetPath.c_str() );
+            ::unlink( Config::SokcetPath.c_str() );
         }
 
         static void Daemonize()
@@ -675,8 +3425,9 @@ namespace EasyFCGI
         static void RedirectIO()
         {
             // shutdown previous stale process using pid file
+            // previous process handing over its socket drains on its own, see Handover::Acknowledge
             auto PidFilePathStr = Config::PidFilePath.c_str();
-            if( FS::exists( Config::PidFilePath ) )
+            if( Handover::Predecessor == -1 && FS::exists( Config::PidFilePath ) )
             {
                 if( auto PID = ReadContent( Config::PidFilePath ).data() | ConvertTo<int> | ParseUtil::FallBack( 0 ) )
                 {
@@ -741,7 +3492,7 @@ namespace EasyFCGI
         }
     }  // namespace ConfigureIO
 
-    extern "C" void OS_LibShutdown();  // for omitting #include <fcgios.h>
+    static volatile std::sig_atomic_t ReceivedSignal = 0;
     static auto ServerInitialization() -> void
     {
         static auto ServerInitializationComplete = false;
@@ -749,32 +3500,84 @@ namespace EasyFCGI
 
         ConfigureIO::RunSequence();
 
-        if( auto ErrorCode = FCGX_Init(); ErrorCode == 0 )
-        {
-            std::println( "[ OK ]  ServerInitialization : FCGX_Init" );
-            std::atexit( OS_LibShutdown );
+        struct sigaction SignalAction;
+        sigemptyset( &SignalAction.sa_mask );
+        SignalAction.sa_flags = 0;  // disable SA_RESTART
+        SignalAction.sa_handler = []( int Signal ) {
+            ReceivedSignal = Signal;
+            TerminationSource.request_stop();  // wakes up reactors and workers waiting for requests
+        };
+        ::sigaction( SIGINT, &SignalAction, nullptr );
+        ::sigaction( SIGHUP, &SignalAction, nullptr );
+        ::sigaction( SIGTERM, &SignalAction, nullptr );
 
-            struct sigaction SignalAction;
-            sigemptyset( &SignalAction.sa_mask );
-            SignalAction.sa_flags = 0;  // disable SA_RESTART
-            SignalAction.sa_handler = []( int Signal ) {
-                TerminationSource.request_stop();
-                FCGX_ShutdownPending();
-            };
-            ::sigaction( SIGINT, &SignalAction, nullptr );
-            ::sigaction( SIGHUP, &SignalAction, nullptr );
-            ::sigaction( SIGTERM, &SignalAction, nullptr );
+        // SIGPIPE not needed to be ignored, all writes use MSG_NOSIGNAL
+        // sigemptyset( &SignalAction.sa_mask );
+        // SignalAction.sa_handler = SIG_IGN;
+        // ::sigaction( SIGPIPE, &SignalAction, nullptr );
 
-            // sigemptyset( &SignalAction.sa_mask );
-            // SignalAction.sa_handler = SIG_IGN;
-            // ::sigaction( SIGPIPE, &SignalAction, nullptr );
-        }
-        else
+        std::println( "[ OK ]  ServerInitialization" );
+    };
+
+    // master process never returns, it supervises worker processes until termination then exits
+    // worker processes return and carry on as ordinary single process server
+    static auto PreforkWorkerProcesses( std::size_t ProcessCount ) -> void
+    {
+        auto MasterPID = ::getpid();
+        auto Workers = std::vector<pid_t>( ProcessCount, 0 );
+        auto Spawn = [MasterPID]( pid_t& Slot ) -> bool {  // true in worker process
+            std::fflush( stdout );
+            auto PID = ::fork();
+            if( PID == -1 )
+            {
+                std::println( "[ Error {} ] {}\n Fail to fork worker process", errno, strerrordesc_np( errno ) );
+                return false;
+            }
+            if( PID == 0 )
+            {
+                ::prctl( PR_SET_PDEATHSIG, SIGTERM );
+                if( ::getppid() != MasterPID ) std::exit( 0 );  // master gone before prctl
+                return true;
+            }
+            Slot = PID;
+            return false;
+        };
+
+        while( ! TerminationRequested() )
         {
-            std::println( "[ Fatal, Error = {} ]  ServerInitialization : FCGX_Init NOT Successful", ErrorCode );
-            std::exit( ErrorCode );
+            for( auto& PID : Workers )
+                if( PID == 0 && Spawn( PID ) ) return;
+
+            auto Status = 0;
+            auto ExitedPID = ::waitpid( -1, &Status, 0 );
+            if( ExitedPID == -1 )
+            {
+                if( errno != EINTR ) SleepFor( 1s );  // no worker alive, fork keeps failing
+                continue;
+            }
+
+            auto Slot = RNG::find( Workers, ExitedPID );
+            if( Slot == Workers.end() ) continue;
+            *Slot = 0;
+            if( TerminationRequested() ) break;
+
+            if( WIFSIGNALED( Status ) )
+                std::println( "[ Warning ] Worker process {} killed by signal {}. Restarting.", ExitedPID, WTERMSIG( Status ) );
+            else
+                std::println( "[ Warning ] Worker process {} exited with code {}. Restarting.", ExitedPID, WEXITSTATUS( Status ) );
+            SleepFor( 100ms );  // throttle crash loop
         }
-    };
+
+        // coordinated drain, forward the received signal and wait for all workers
+        auto Signal = ReceivedSignal != 0 ? static_cast<int>( ReceivedSignal ) : SIGTERM;
+        for( auto PID : Workers )
+            if( PID > 0 ) ::kill( PID, Signal );
+        while( ::waitpid( -1, nullptr, 0 ) > 0 || errno == EINTR ) continue;
+
+        std::println( "All worker processes exited." );
+        std::fflush( stdout );
+        std::exit( 0 );
+    }
 
     Server::RequestQueue::RequestQueue( SocketFileDescriptor SourceSocketFD ) : ListenSocket{ SourceSocketFD } {};
 
@@ -810,11 +3613,23 @@ namespace EasyFCGI
     {
         ServerInitialization();
         // std::println( "Server file descriptor : {}", static_cast<int>( ListenSocket ) );
-        std::println( "Unix Socket Path : {}", UnixSocketName( ListenSocket ).c_str() );
+        if( auto TCPName = TCPSocketName( ListenSocket ); ! TCPName.empty() )
+            std::println( "TCP Listen Address : {}", TCPName );
+        else
+            std::println( "Unix Socket Path : {}", UnixSocketName( ListenSocket ).c_str() );
         std::println( "Log File Path : {}", Config::LogFilePath.c_str() );
         std::println( "PID File Path : {}", Config::PidFilePath.c_str() );
         std::println( "Ready to accept requests..." );
         std::fflush( stdout );
+
+        Handover::Acknowledge();
+        if( Config::SocketHandover ) Handover::Serve( ListenSocket, UnixSocketName( ListenSocket ) );
+
+        if( Config::WorkerProcessCount > 0 )
+        {
+            std::println( "[ OK ]  Prefork : {} worker processes", Config::WorkerProcessCount );
+            PreforkWorkerProcesses( Config::WorkerProcessCount );
+        }
     }
 
     /// TODO: rework constructor set design, it is shit now
@@ -823,18 +3638,319 @@ namespace EasyFCGI
     Server::Server( const FS::path& SocketPath )
         : Server( SocketPath.empty()  //
                       ? SocketFileDescriptor{}
-                      : FCGX_OpenSocket( SocketPath.c_str(), Config::DefaultBackLogNumber ) )
+                      : OpenListenSocket( SocketPath ) )
     {
-        auto FD = RequestQueue.ListenSocket;
-        if( FD == -1 )
+        if( RequestQueue.ListenSocket == -1 )
         {
             std::println( "[ Fatal ] Failed to open socket." );
             std::exit( -1 );
         }
-        if( FD > 0 )
+    }
+
+    static auto PinCurrentThread( const std::vector<int>& CPUs ) -> void
+    {
+        auto CPUSet = cpu_set_t{};
+        CPU_ZERO( &CPUSet );
+        for( auto CPU : CPUs ) CPU_SET( CPU, &CPUSet );
+        if( ::sched_setaffinity( 0, sizeof( CPUSet ), &CPUSet ) == -1 )  //
+            std::println( "[ Error {} ] {}\n Fail to pin worker thread to CPU {}", errno, strerrordesc_np( errno ), CPUs );
+    }
+    static auto PinCurrentThread( int CPU ) -> void { PinCurrentThread( std::vector{ CPU } ); }
+
+    namespace NUMA
+    {
+        // online nodes and their CPUs, single entry on non-NUMA hosts
+        static auto Topology() -> const std::map<int, std::vector<int>>&
+        {
+            static auto Nodes = [] {
+                auto Result = std::map<int, std::vector<int>>{};
+                auto EC = std::error_code{};
+                for( auto& Entry : FS::directory_iterator( "/sys/devices/system/node", EC ) )
+                {
+                    auto Name = Entry.path().filename().native();
+                    if( ! StrView{ Name }.starts_with( "node" ) ) continue;
+                    auto Node = StrView{ Name }.substr( 4 ) | ConvertTo<int> | ParseUtil::FallBack( -1 );
+                    auto CPUListContent = ReadContent( Entry.path() / "cpulist" );
+                    auto CPUList = StrView{ CPUListContent.data(), CPUListContent.size() };
+                    while( CPUList.ends_with( '\n' ) ) CPUList.remove_suffix( 1 );
+                    if( Node < 0 || CPUList.empty() ) continue;  // memory only node
+                    if( auto CPUs = Config::ParseCPUList( CPUList ); ! CPUs.empty() ) Result.emplace( Node, std::move( CPUs ) );
+                }
+                return Result;
+            }();
+            return Nodes;
+        }
+
+        static auto NodeOf( int CPU ) -> int
         {
-            FS::permissions( SocketPath, FS::perms::all );
+            for( auto& [Node, CPUs] : Topology() )
+                if( RNG::contains( CPUs, CPU ) ) return Node;
+            return -1;
+        }
+
+        // pages first touched by calling thread come from Node, other nodes only when it runs out
+        static auto PreferNode( int Node ) -> void
+        {
+            if( Node < 0 || Topology().size() < 2 ) return;
+            auto NodeMask = std::array<unsigned long, 16>{};
+            constexpr auto BitsPerMask = sizeof( unsigned long ) * 8;
+            if( static_cast<std::size_t>( Node ) >= NodeMask.size() * BitsPerMask ) return;
+            NodeMask[Node / BitsPerMask] |= 1UL << Node % BitsPerMask;
+            if( ::syscall( SYS_set_mempolicy, MPOL_PREFERRED, NodeMask.data(), NodeMask.size() * BitsPerMask ) == -1 )
+                std::println( "[ Error {} ] {}\n Fail to prefer memory from NUMA node {}", errno, strerrordesc_np( errno ), Node );
+        }
+
+        // CPUs of all nodes taken in turn, consecutive shards land on different nodes
+        static auto InterleavedCPUs( const std::vector<int>& AllowedCPUs ) -> std::vector<int>
+        {
+            auto PerNode = std::vector<std::vector<int>>{};
+            for( auto& [Node, CPUs] : Topology() )
+                PerNode.push_back( CPUs | VIEW::filter( [&]( int CPU ) { return RNG::contains( AllowedCPUs, CPU ); } ) | RNG::to<std::vector>() );
+            auto Result = std::vector<int>{};
+            for( auto Round = 0uz; Result.size() < AllowedCPUs.size(); ++Round )
+            {
+                auto Before = Result.size();
+                for( auto& CPUs : PerNode )
+                    if( Round < CPUs.size() ) Result.push_back( CPUs[Round] );
+                if( Result.size() == Before ) break;  // allowed CPUs outside known nodes
+            }
+            return Result.empty() ? AllowedCPUs : Result;
+        }
+    }  // namespace NUMA
+
+    // CPUs a worker may run on and the node its memory should come from, empty CPUs for no pinning
+    struct WorkerPlacement
+    {
+        std::vector<int> CPUs{};
+        int Node = -1;
+    };
+
+    static auto PlaceWorker( const Server::WorkerPoolOptions& Options, std::size_t WorkerIndex ) -> WorkerPlacement
+    {
+        if( ! Options.CPUAffinity.empty() )
+        {
+            auto CPU = Options.CPUAffinity[WorkerIndex % Options.CPUAffinity.size()];
+            return { { CPU }, Options.NUMAAware ? NUMA::NodeOf( CPU ) : -1 };
+        }
+        auto& Nodes = NUMA::Topology();
+        if( ! Options.NUMAAware || Nodes.size() < 2 ) return {};
+        auto [Node, CPUs] = *std::next( Nodes.begin(), static_cast<std::ptrdiff_t>( WorkerIndex % Nodes.size() ) );
+        return { CPUs, Node };
+    }
+
+    static auto PlaceCurrentThread( const WorkerPlacement& Placement ) -> void
+    {
+        if( ! Placement.CPUs.empty() ) PinCurrentThread( Placement.CPUs );
+        NUMA::PreferNode( Placement.Node );
+    }
+
+    static auto ReportPlacement( const std::vector<WorkerPlacement>& Placements ) -> void
+    {
+        for( auto&& [WorkerIndex, Placement] : Placements | VIEW::enumerate )
+            if( ! Placement.CPUs.empty() || Placement.Node >= 0 )
+                std::println( "[ OK ]  Worker {} : CPU {}, memory node {}", WorkerIndex, Placement.CPUs, Placement.Node );
+    }
+
+    static auto ReportHandlerException( Request& Request, const std::exception& Error ) -> void
+    {
+        std::println( "[ Error ] Unhandled exception in request handler : {}", Error.what() );
+        if( Request.Response.StatusCode != HTTP::StatusCode::InternalUse_HeaderAlreadySent )  //
+            Request.Response.Reset().Set( HTTP::StatusCode::InternalServerError );
+    }
+
+    // Return: [ false ] if handler threw
+    static auto Dispatch( const RequestHandler& Handler, Request& Request ) -> bool
+    {
+        try
+        {
+            Handler( Request );
+            return true;
+        }
+        catch( const std::exception& Error )
+        {
+            ReportHandlerException( Request, Error );
+            return false;
+        }
+    }
+
+    // Request lives in the coroutine frame, response flushed when the frame is destroyed
+    static auto Serve( const AsyncRequestHandler& Handler, Request Request ) -> Async::DetachedTask
+    {
+        try
+        {
+            co_await Handler( Request );
+        }
+        catch( const std::exception& Error )
+        {
+            ReportHandlerException( Request, Error );
+        }
+        Async::EventLoop::Instance().Retire();
+    }
+
+    auto Server::Run( RequestHandler Handler ) -> void { Run( std::move( Handler ), WorkerPoolOptions{} ); }
+    auto Server::Run( RequestHandler Handler, WorkerPoolOptions Options ) -> void
+    {
+        auto ListenSocket = RequestQueue.ListenSocket;
+        auto ThreadCount = std::max( Options.ThreadCount, 1uz );
+
+        auto Placements = VIEW::iota( 0uz, ThreadCount ) | VIEW::transform( [&]( auto WorkerIndex ) { return PlaceWorker( Options, WorkerIndex ); } ) | RNG::to<std::vector>();
+        auto Workers = std::vector<std::jthread>{};
+        Workers.reserve( ThreadCount );
+        for( auto WorkerIndex : VIEW::iota( 0uz, ThreadCount ) )
+            Workers.emplace_back( [&, WorkerIndex] {
+                PlaceCurrentThread( Placements[WorkerIndex] );  // before first allocation of this thread
+                struct RequestQueue WorkerQueue{ ListenSocket };
+                for( auto Request : WorkerQueue ) Dispatch( Handler, Request );
+            } );
+
+        std::println( "[ OK ]  Server::Run : {} worker threads", ThreadCount );
+        ReportPlacement( Placements );
+        std::fflush( stdout );
+    }  // workers joined on destruction
+
+    static thread_local auto CurrentShardIndex = 0uz;
+    auto CurrentShard() -> std::size_t { return CurrentShardIndex; }
+
+    // written only by owning shard, cache line each
+    struct alignas( 64 ) ShardCounters
+    {
+        std::atomic<std::uint64_t> Requests{};
+        std::atomic<std::uint64_t> Failures{};
+    };
+    static auto ShardCounterSlots = std::unique_ptr<ShardCounters[]>{};
+    static auto ShardCounterCount = std::atomic<std::size_t>{ 0 };
+
+    auto ShardMetricsSnapshot() -> std::vector<ShardMetrics>
+    {
+        auto Result = std::vector<ShardMetrics>( ShardCounterCount.load( std::memory_order_acquire ) );
+        for( auto&& [Index, Metrics] : Result | VIEW::enumerate )
+            Metrics = { .Requests = ShardCounterSlots[Index].Requests.load( std::memory_order_relaxed ),
+                        .Failures = ShardCounterSlots[Index].Failures.load( std::memory_order_relaxed ) };
+        return Result;
+    }
+
+    static auto AllowedCPUs() -> std::vector<int>
+    {
+        auto CPUSet = cpu_set_t{};
+        auto Result = std::vector<int>{};
+        if( ::sched_getaffinity( 0, sizeof( CPUSet ), &CPUSet ) == 0 )
+            for( auto CPU : VIEW::iota( 0, CPU_SETSIZE ) )
+                if( CPU_ISSET( CPU, &CPUSet ) ) Result.push_back( CPU );
+        return Result;
+    }
+
+    // Return: listen socket of shard, -1 with Reason set if the listener cannot be sharded
+    static auto OpenShardSocket( SocketFileDescriptor ListenSocket, std::size_t Shard, std::string& Reason ) -> SocketFileDescriptor
+    {
+        if( Shard == 0 ) return ListenSocket;
+        auto FD = SocketFileDescriptor{ -1 };
+        if( auto Name = TCPSocketName( ListenSocket ); ! Name.empty() )
+        {
+            auto ReusePort = 0;
+            auto Length = socklen_t{ sizeof( ReusePort ) };
+            if( ::getsockopt( ListenSocket, SOL_SOCKET, SO_REUSEPORT, &ReusePort, &Length ) != 0 || ReusePort == 0 )
+                Reason = "TCP requires --reuseport";
+            else if( FD = OpenTCPSocket( *TCPAddress( Name ), Config::DefaultBackLogNumber ); FD == -1 )
+                Reason = "fail to listen on {}"_FMT( Name );
+        }
+        else if( auto SocketPath = UnixSocketName( ListenSocket ); ! SocketPath.empty() )
+        {
+            if( FD = OpenUnixSocket( SocketPath += ".{}"_FMT( Shard ), Config::DefaultBackLogNumber ); FD == -1 )
+                Reason = "fail to listen on {} : {}"_FMT( SocketPath.native(), strerrordesc_np( errno ) );
+        }
+        else
+            Reason = "neither TCP nor Unix socket";
+        return FD;
+    }
+
+    auto Server::RunSharded( RequestHandler Handler ) -> void { RunSharded( std::move( Handler ), ShardOptions{} ); }
+    auto Server::RunSharded( RequestHandler Handler, ShardOptions Options ) -> void
+    {
+        auto ShardCount = std::max( Options.ShardCount, 1uz );
+        auto CPUs = ! Options.CPUAffinity.empty() ? Options.CPUAffinity : Options.NUMAAware ? NUMA::InterleavedCPUs( AllowedCPUs() ) : AllowedCPUs();
+        if( CPUs.empty() ) CPUs.push_back( 0 );
+
+        auto ShardSockets = std::vector<SocketFileDescriptor>{};
+        for( auto Shard : VIEW::iota( 0uz, ShardCount ) )
+        {
+            auto Reason = std::string{};
+            auto FD = OpenShardSocket( RequestQueue.ListenSocket, Shard, Reason );
+            if( FD == -1 )
+            {
+                std::println( "[ Warning ] Listen socket cannot be sharded ( {} ), {} shards share it", Reason, ShardCount );
+                // shard sockets opened so far would stay bound with nobody accepting on them
+                for( auto Opened : ShardSockets | VIEW::drop( 1 ) )
+                {
+                    if( auto SocketPath = UnixSocketName( Opened ); ! SocketPath.empty() ) ::unlink( SocketPath.c_str() );
+                    ::close( Opened );
+                }
+                ShardSockets.assign( ShardCount, RequestQueue.ListenSocket );
+                break;
+            }
+            ShardSockets.push_back( FD );
+        }
+
+        ShardCounterSlots = std::make_unique<ShardCounters[]>( ShardCount );
+        ShardCounterCount.store( ShardCount, std::memory_order_release );
+
+        auto Shards = std::vector<std::jthread>{};
+        Shards.reserve( ShardCount );
+        for( auto Shard : VIEW::iota( 0uz, ShardCount ) )
+        {
+            auto CPU = CPUs[Shard % CPUs.size()];
+            if( Shard == 0 || ShardSockets[Shard] != ShardSockets[0] ) FastCGI::Engine::Attach( ShardSockets[Shard] ).PinReactor( CPU );
+            Shards.emplace_back( [&, Shard, CPU] {
+                CurrentShardIndex = Shard;
+                PlaceCurrentThread( { { CPU }, Options.NUMAAware ? NUMA::NodeOf( CPU ) : -1 } );  // heap allocations from here on come from this thread's malloc arena
+                auto& Counters = ShardCounterSlots[Shard];
+                struct RequestQueue ShardQueue{ ShardSockets[Shard] };
+                for( auto Request : ShardQueue )
+                {
+                    if( ! Dispatch( Handler, Request ) ) Counters.Failures.fetch_add( 1, std::memory_order_relaxed );
+                    Counters.Requests.fetch_add( 1, std::memory_order_relaxed );
+                }
+            } );
         }
+
+        std::println( "[ OK ]  Server::RunSharded : {} shards on CPU {}", ShardCount, CPUs | VIEW::take( ShardCount ) );
+        if( Options.NUMAAware )
+            for( auto Shard : VIEW::iota( 0uz, ShardCount ) )
+                std::println( "[ OK ]  Shard {} : CPU {}, memory node {}", Shard, CPUs[Shard % CPUs.size()], NUMA::NodeOf( CPUs[Shard % CPUs.size()] ) );
+        std::fflush( stdout );
+
+        Shards.clear();  // join
+        for( auto&& [Shard, Metrics] : ShardMetricsSnapshot() | VIEW::enumerate )
+            std::println( "[ OK ]  Shard {} : {} requests, {} failures", Shard, Metrics.Requests, Metrics.Failures );
     }
 
+    auto Server::RunAsync( AsyncRequestHandler Handler ) -> void { RunAsync( std::move( Handler ), WorkerPoolOptions{} ); }
+    auto Server::RunAsync( AsyncRequestHandler Handler, WorkerPoolOptions Options ) -> void
+    {
+        auto& Loop = Async::EventLoop::Instance();
+        auto ListenSocket = RequestQueue.ListenSocket;
+        auto ThreadCount = std::max( Options.ThreadCount, 1uz );
+
+        auto Placements = VIEW::iota( 0uz, ThreadCount ) | VIEW::transform( [&]( auto WorkerIndex ) { return PlaceWorker( Options, WorkerIndex ); } ) | RNG::to<std::vector>();
+        auto Workers = std::vector<std::jthread>{};
+        Workers.reserve( ThreadCount + 1 );
+        for( auto WorkerIndex : VIEW::iota( 0uz, ThreadCount ) )
+            Workers.emplace_back( [&, WorkerIndex] {
+                PlaceCurrentThread( Placements[WorkerIndex] );
+                while( auto Handle = Loop.NextReady() ) Handle.resume();
+            } );
+
+        // acceptor only wraps requests into coroutines, handlers always run on worker threads
+        // workers outlive the acceptor, which keeps spawning while draining
+        Loop.Retain();
+        Workers.emplace_back( [&] {
+            struct RequestQueue AcceptorQueue{ ListenSocket };
+            for( auto Request : AcceptorQueue ) Loop.Spawn( Serve( Handler, std::move( Request ) ).Handle );
+            Loop.Retire();
+        } );
+
+        std::println( "[ OK ]  Server::RunAsync : {} worker threads", ThreadCount );
+        ReportPlacement( Placements );
+        std::fflush( stdout );
+    }  // workers joined on destruction
+
 }  // namespace EasyFCGI
@@ -0,0 +1,47 @@
+#include "EasyFCGI.cpp"
+#include "Check.h"
+
+using namespace EasyFCGI;
+
+int main()
+{
+    auto Ready = []( FastCGI::RequestContext& Context ) { return Context.ReadyTime = std::chrono::steady_clock::now(), Context.Admit(); };
+
+    // unlimited by default
+    Config::MaxInFlightRequests = 0;
+    Config::MaxQueueDelay = 0ms;
+    {
+        auto Many = std::vector<FastCGI::RequestContext>( 8 );
+        for( auto& Context : Many ) CHECK( Ready( Context ) );
+    }
+
+    // admitted requests hold their place until finished
+    Config::MaxInFlightRequests = 2;
+    {
+        auto First = FastCGI::RequestContext{};
+        auto Second = FastCGI::RequestContext{};
+        auto Third = FastCGI::RequestContext{};
+        CHECK( Ready( First ) );
+        CHECK( Ready( Second ) );
+        CHECK( ! Ready( Third ) );
+        CHECK( ! Third.Admitted );
+        First.Finish();
+        CHECK( Ready( Third ) );
+        First.Finish();  // released once only
+        CHECK( ! Ready( First ) );
+    }
+    {
+        auto Context = FastCGI::RequestContext{};
+        CHECK( Ready( Context ) );  // places given back on destruction
+    }
+
+    // waited too long for a worker
+    Config::MaxInFlightRequests = 0;
+    Config::MaxQueueDelay = 100ms;
+    auto Stale = FastCGI::RequestContext{};
+    Stale.ReadyTime = std::chrono::steady_clock::now() - 1s;
+    CHECK( ! Stale.Admit() );
+    CHECK( Ready( Stale ) );
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,22 @@
+#ifndef _EASY_FCGI_TEST_CHECK_H
+#define _EASY_FCGI_TEST_CHECK_H
+
+// parser unit tests compile src/EasyFCGI.cpp into the test itself, internal helpers reachable
+// each test is a plain executable, non-zero exit on any failed CHECK
+
+#include <print>
+
+inline auto FailedChecks = 0;
+
+#define CHECK( ... )                                                                 \
+    do {                                                                             \
+        if( ! ( __VA_ARGS__ ) )                                                      \
+        {                                                                            \
+            ++FailedChecks;                                                          \
+            std::println( "[ Fail ] {}:{}  CHECK( {} )", __FILE__, __LINE__, #__VA_ARGS__ ); \
+        }                                                                            \
+    } while( false )
+
+#define TEST_RESULT() ( std::println( "{} failed check(s)", FailedChecks ), FailedChecks == 0 ? 0 : 1 )
+
+#endif
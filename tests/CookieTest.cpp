@@ -0,0 +1,49 @@
+#include "EasyFCGI.cpp"
+#include "Check.h"
+
+using namespace EasyFCGI;
+
+// FastCGI name-value pairs, short lengths only
+static auto EncodeParams( std::initializer_list<std::pair<StrView, StrView>> Params ) -> std::string
+{
+    auto Encoded = std::string{};
+    for( auto [Name, Value] : Params )
+        Encoded.append( 1, static_cast<char>( Name.length() ) ).append( 1, static_cast<char>( Value.length() ) ).append( Name ).append( Value );
+    return Encoded;
+}
+
+int main()
+{
+    auto Context = FastCGI::RequestContext{};
+    CHECK( FastCGI::BuildEnvironment( Context, EncodeParams( { { "REQUEST_METHOD", "GET" },
+                                                               { "HTTP_COOKIE", R"(a=1; b="quoted value"; c=%41%zz; e=%42%43; a=2; flag; =x;  d = spaced )" } } ) ) );
+
+    struct Request::Cookie Jar{};  // member of same name hides the type
+    Jar.Bind( &Context );
+    CHECK( Jar.size() == 6 );
+    CHECK( Jar["a"] == "1" );  // first of repeated name
+    CHECK( Jar["b"] == "quoted value" );
+    CHECK( Jar["c"] == "A%zz" );  // malformed escape kept as is
+    CHECK( Jar["e"] == "BC" );    // earlier decoded value still valid
+    CHECK( Jar["d"] == "spaced" );
+    CHECK( ! Jar.contains( "flag" ) );
+    CHECK( ! Jar.contains( "" ) );
+    CHECK( Jar["missing"].empty() );
+
+    auto Names = std::string{};
+    for( auto [Name, Value] : Jar ) Names.append( Name );
+    CHECK( Names == "abcead" );  // order of appearance, repeats kept
+
+    // rebinding drops previous request, absent header gives empty jar
+    auto Plain = FastCGI::RequestContext{};
+    CHECK( FastCGI::BuildEnvironment( Plain, EncodeParams( { { "REQUEST_METHOD", "GET" } } ) ) );
+    Jar.Bind( &Plain );
+    CHECK( Jar.size() == 0 );
+    CHECK( Jar.begin() == Jar.end() );
+    CHECK( ! Jar.contains( "a" ) );
+
+    Jar.Bind( nullptr );
+    CHECK( Jar["a"].empty() );
+
+    return TEST_RESULT();
+}
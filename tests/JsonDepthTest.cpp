@@ -0,0 +1,23 @@
+#include "EasyFCGI.cpp"
+#include "Check.h"
+
+using EasyFCGI::FastCGI::JsonDepth;
+
+int main()
+{
+    CHECK( JsonDepth( "", 64 ) == 0 );
+    CHECK( JsonDepth( "42", 64 ) == 0 );
+    CHECK( JsonDepth( R"({"a":[1,{"b":[]}]})", 64 ) == 4 );
+    CHECK( JsonDepth( R"([[[]]])", 2 ) == 3 );  // stops once beyond Limit
+    CHECK( JsonDepth( R"({"a":"[[[{{{"})", 64 ) == 1 );  // brackets inside strings ignored
+    CHECK( JsonDepth( R"({"a\"[[":"\\"})", 64 ) == 1 );  // escaped quote and escaped backslash
+
+    // unterminated strings end the scan, never rescan from the start
+    CHECK( JsonDepth( R"("abc)", 64 ) == 0 );
+    CHECK( JsonDepth( R"({"a)", 64 ) == 1 );
+    CHECK( JsonDepth( R"([{"a":"b\")", 64 ) == 2 );  // escaped quote right at the end
+    CHECK( JsonDepth( R"(["\)", 64 ) == 1 );        // lone backslash at the end
+    CHECK( JsonDepth( R"(")", 64 ) == 0 );
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,71 @@
+#include "EasyFCGI.cpp"
+#include "Check.h"
+#include <random>
+
+using namespace EasyFCGI;
+
+int main()
+{
+    // delimiter search against plain find, matches at every offset and across block boundaries
+    auto Engine = std::mt19937{ 7 };
+    auto LongestBoundary = std::string( MultiPart::BoundaryLengthLimit, 'q' );
+    for( auto Boundary : { "b"sv, "XyZ"sv, "----WebKitFormBoundary7MA4YWxkTrZu0gW"sv, StrView{ LongestBoundary } } )
+    {
+        auto Searcher = MultiPart::DelimiterSearcher{ Boundary };
+        auto Delimiter = std::string{ "\r\n--" }.append( Boundary );
+        for( auto Round = 0; Round < 2000; ++Round )
+        {
+            auto Haystack = std::string{};
+            for( auto Length = Engine() % 300; Haystack.length() < Length; )
+            {
+                if( Engine() % 8 == 0 )
+                    Haystack += Delimiter.substr( 0, Engine() % ( Delimiter.length() + 1 ) );  // whole or partial
+                else
+                    Haystack += "\r\n-qbXZ"[Engine() % 7];
+            }
+            for( auto From = 0uz; From <= Haystack.length(); From += 1 + Engine() % 16 ) CHECK( Searcher.Find( Haystack, From ) == StrView{ Haystack }.find( Delimiter, From ) );
+        }
+    }
+
+    // parts in order, preamble and transport padding skipped, closing delimiter ends the scan
+    constexpr auto ContentType = "multipart/form-data; boundary=\"XyZ\""sv;
+    constexpr auto Body = "preamble\r\n"
+                          "--XyZ \t\r\n"
+                          "Content-Disposition: form-data; name=\"a\"\r\n"
+                          "\r\n"
+                          "1\r\n"
+                          "--XyZ\r\n"
+                          "content-disposition: form-data; name=\"f\"; filename=\"x.txt\"\r\n"
+                          "Content-Type: text/plain\r\n"
+                          "\r\n"
+                          "file\r\nbody\r\n"
+                          "--XyZ\r\n"
+                          "no header block\r\n"
+                          "--XyZ--\r\n"
+                          "--XyZ\r\n"
+                          "Content-Disposition: form-data; name=\"late\"\r\n"
+                          "\r\n"
+                          "after closing\r\n"
+                          "--XyZ--"sv;
+    auto Parts = std::vector<std::array<std::string, 4>>{};
+    MultiPart::Scan( ContentType, Body, [&]( StrView Name, StrView FileName, StrView PartType, StrView Content ) {
+        Parts.push_back( { std::string{ Name }, std::string{ FileName }, std::string{ PartType }, std::string{ Content } } );
+    } );
+    CHECK( Parts.size() == 2 );
+    if( Parts.size() == 2 )
+    {
+        CHECK( Parts[0] == std::array<std::string, 4>{ "a", "", "", "1" } );
+        CHECK( Parts[1] == std::array<std::string, 4>{ "f", "x.txt", "text/plain", "file\r\nbody" } );
+    }
+
+    // truncated body, part without closing delimiter dropped
+    Parts.clear();
+    MultiPart::Scan( ContentType, Body.substr( 0, Body.find( "file\r\n" ) ), [&]( auto&&... ) { Parts.push_back( {} ); } );
+    CHECK( Parts.size() == 1 );
+
+    CHECK( MultiPart::BoundaryOf( "multipart/form-data; boundary=abc; charset=utf-8" ) == "abc" );
+    CHECK( MultiPart::CountParts( "multipart/form-data; boundary=XyZ", "--XyZ\r\n\r\n--XyZ\r\n\r\n--XyZ--" ) == 2 );
+    CHECK( MultiPart::CountParts( "multipart/form-data", "--XyZ--" ) == 0 );
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,42 @@
+#include "EasyFCGI.cpp"
+#include "Check.h"
+
+using namespace EasyFCGI;
+
+int main()
+{
+    struct Request::Query Query{};  // member of same name hides the type
+    Query.Bind( nullptr );
+    Query.AppendEncoded( "a=1&b=x+y&a=2&c=%41&=skipped&flag&a=3" );
+    CHECK( Query.Entries.size() == 6 );
+    CHECK( Query["a"] == "1" );  // first of repeated key
+    CHECK( Query["a", 1] == "2" );
+    CHECK( Query["a", 2] == "3" );
+    CHECK( ! Query.GetOptional( "a", 3 ) );
+    CHECK( Query.CountRepeated( "a" ) == 3 );
+    CHECK( Query["b"] == "x y" );
+    CHECK( Query["c"] == "A" );
+    CHECK( Query.contains( "flag" ) && Query["flag"].empty() );
+    CHECK( ! Query.contains( "" ) );
+    CHECK( ! Query.contains( "missing" ) );
+    CHECK( Query.CountRepeated( "missing" ) == 0 );
+
+    // enough keys to rehash the slot table several times, repeats still chained
+    for( auto Index = 0; Index < 1000; ++Index )
+        Query.Append( std::format( "k{}", Index % 300 ), std::to_string( Index ) );
+    CHECK( Query["a", 2] == "3" );
+    CHECK( Query.CountRepeated( "k0" ) == 4 );
+    CHECK( Query.CountRepeated( "k299" ) == 3 );
+    CHECK( Query["k7", 3] == "907" );
+    auto AllFound = true;
+    for( auto Index = 0; Index < 300; ++Index )
+        AllFound = AllFound && Query[std::format( "k{}", Index )] == std::to_string( Index );
+    CHECK( AllFound );
+    CHECK( ! Query.contains( "k300" ) );
+
+    Query.clear();
+    CHECK( Query.Entries.empty() );
+    CHECK( ! Query.contains( "a" ) );
+
+    return TEST_RESULT();
+}
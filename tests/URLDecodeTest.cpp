@@ -0,0 +1,60 @@
+#include "EasyFCGI.cpp"
+#include "Check.h"
+#include <random>
+
+// byte at a time, as decoded before vectorization
+static auto ReferenceDecode( StrView Fragment ) -> std::string
+{
+    auto Result = std::string{};
+    for( auto I = 0uz; I < Fragment.length(); ++I )
+    {
+        if( Fragment[I] == '+' )
+        {
+            Result += ' ';
+            continue;
+        }
+        if( Fragment[I] != '%' )
+        {
+            Result += Fragment[I];
+            continue;
+        }
+        auto High = I + 1 < Fragment.length() ? ParseUtil::HexDigitValue[static_cast<unsigned char>( Fragment[I + 1] )] : -1;
+        auto Low = I + 2 < Fragment.length() ? ParseUtil::HexDigitValue[static_cast<unsigned char>( Fragment[I + 2] )] : -1;
+        Result += High < 0 || Low < 0 ? '?' : static_cast<char>( High << 4 | Low );
+        I += std::min( 2uz, Fragment.length() - I - 1 );
+    }
+    return Result;
+}
+
+int main()
+{
+    using ParseUtil::DecodeURLFragment;
+    CHECK( DecodeURLFragment( "" ) == "" );
+    CHECK( DecodeURLFragment( "a+b%20c" ) == "a b c" );
+    CHECK( DecodeURLFragment( "%41%4a%4A" ) == "AJJ" );
+    CHECK( DecodeURLFragment( "%" ) == "?" );
+    CHECK( DecodeURLFragment( "%4" ) == "?" );
+    CHECK( DecodeURLFragment( "%zz1" ) == "?1" );
+    CHECK( DecodeURLFragment( std::string( 100, 'x' ) + "%41" ) == std::string( 100, 'x' ) + "A" );  // past whole blocks
+
+    auto Appended = std::string{ "k=" };
+    DecodeURLFragment( "v%31", Appended );
+    CHECK( Appended == "k=v1" );
+
+    // random fragments over every block boundary, into a separate buffer and in place
+    auto Engine = std::mt19937{ 2024 };
+    constexpr auto Alphabet = StrView{ "ab%+0F9g" };
+    for( auto Round = 0; Round < 20000; ++Round )
+    {
+        auto Fragment = std::string( Engine() % 100, ' ' );
+        for( auto& C : Fragment ) C = Alphabet[Engine() % Alphabet.length()];
+        auto Expected = ReferenceDecode( Fragment );
+        CHECK( DecodeURLFragment( Fragment ) == Expected );
+
+        auto InPlace = Fragment;
+        InPlace.resize( DecodeURLFragment( InPlace, InPlace.data() ) - InPlace.data() );
+        CHECK( InPlace == Expected );
+    }
+
+    return TEST_RESULT();
+}